@@ -1,13 +1,139 @@
 #include "ZeDMD.h"
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
+#include <type_traits>
 
-#include "FrameUtil.h"
 #include "ZeDMDComm.h"
+#include "ZeDMDPipeline.h"
+#include "ZeDMDScale.h"
 #include "ZeDMDWiFi.h"
 
-const int endian_check = 1;
-#define is_bigendian() ((*(char*)&endian_check) == 0)
+// Large enough for a frame of the maximum size in any of the frame formats.
+#define ZEDMD_FRAME_BUFFER_SIZE (ZEDMD_MAX_WIDTH * ZEDMD_MAX_HEIGHT * 4)
+
+// Byte positions of the color channels within a pixel of a frame format.
+template <ZEDMD_FRAME_FORMAT format>
+struct PixelLayout;
+template <>
+struct PixelLayout<ZEDMD_FORMAT_RGB888>
+{
+  static constexpr uint8_t bytes = 3, red = 0, green = 1, blue = 2;
+};
+template <>
+struct PixelLayout<ZEDMD_FORMAT_RGB565>
+{
+  static constexpr uint8_t bytes = 2, red = 0, green = 0, blue = 0;
+};
+template <>
+struct PixelLayout<ZEDMD_FORMAT_BGRA8888>
+{
+  static constexpr uint8_t bytes = 4, red = 2, green = 1, blue = 0;
+};
+template <>
+struct PixelLayout<ZEDMD_FORMAT_RGBA8888>
+{
+  static constexpr uint8_t bytes = 4, red = 0, green = 1, blue = 2;
+};
+template <>
+struct PixelLayout<ZEDMD_FORMAT_ARGB8888>
+{
+  static constexpr uint8_t bytes = 4, red = 1, green = 2, blue = 3;
+};
+template <>
+struct PixelLayout<ZEDMD_FORMAT_GRAY8>
+{
+  static constexpr uint8_t bytes = 1, red = 0, green = 0, blue = 0;
+};
+template <>
+struct PixelLayout<ZEDMD_FORMAT_INDEXED8>
+{
+  static constexpr uint8_t bytes = 1, red = 0, green = 0, blue = 0;
+};
+
+static uint8_t GetBytesPerPixel(ZEDMD_FRAME_FORMAT format)
+{
+  switch (format)
+  {
+    case ZEDMD_FORMAT_RGB888:
+      return 3;
+    case ZEDMD_FORMAT_RGB565:
+      return 2;
+    case ZEDMD_FORMAT_GRAY8:
+    case ZEDMD_FORMAT_INDEXED8:
+      return 1;
+    default:
+      return 4;
+  }
+}
+
+// The color lookup table holds the RGB565 bits of the corrected red, green and blue channels, indexed by the 8 bit
+// channel value, see SetColorCorrection(). Palette lookup tables are already corrected.
+template <ZEDMD_FRAME_FORMAT format>
+static inline uint16_t ReadRgb565(const uint8_t* pPixel, const uint16_t* pPaletteLut, const uint16_t* pColorLut)
+{
+  using Layout = PixelLayout<format>;
+
+  if constexpr (format == ZEDMD_FORMAT_INDEXED8)
+  {
+    return pPaletteLut[pPixel[0]];
+  }
+  else if constexpr (format == ZEDMD_FORMAT_RGB565)
+  {
+    uint16_t rgb565;
+    memcpy(&rgb565, pPixel, 2);
+    if (pColorLut)
+    {
+      // Expand the channels to 8 bits by repeating their upper bits.
+      rgb565 = pColorLut[((rgb565 >> 8) & 0xF8) | (rgb565 >> 13)] |
+               pColorLut[256 + (((rgb565 >> 3) & 0xFC) | ((rgb565 >> 9) & 0x03))] |
+               pColorLut[512 + (((rgb565 << 3) & 0xF8) | ((rgb565 >> 2) & 0x07))];
+    }
+    return rgb565;
+  }
+  else
+  {
+    if (pColorLut)
+    {
+      return pColorLut[pPixel[Layout::red]] | pColorLut[256 + pPixel[Layout::green]] |
+             pColorLut[512 + pPixel[Layout::blue]];
+    }
+    return (((uint16_t)(pPixel[Layout::red] & 0xF8)) << 8) | (((uint16_t)(pPixel[Layout::green] & 0xFC)) << 3) |
+           (pPixel[Layout::blue] >> 3);
+  }
+}
+
+static uint16_t ReadRgb565(const uint8_t* pPixel, ZEDMD_FRAME_FORMAT format)
+{
+  switch (format)
+  {
+    case ZEDMD_FORMAT_RGB888:
+      return ReadRgb565<ZEDMD_FORMAT_RGB888>(pPixel, nullptr, nullptr);
+    case ZEDMD_FORMAT_RGB565:
+      return ReadRgb565<ZEDMD_FORMAT_RGB565>(pPixel, nullptr, nullptr);
+    case ZEDMD_FORMAT_BGRA8888:
+      return ReadRgb565<ZEDMD_FORMAT_BGRA8888>(pPixel, nullptr, nullptr);
+    case ZEDMD_FORMAT_RGBA8888:
+      return ReadRgb565<ZEDMD_FORMAT_RGBA8888>(pPixel, nullptr, nullptr);
+    case ZEDMD_FORMAT_ARGB8888:
+      return ReadRgb565<ZEDMD_FORMAT_ARGB8888>(pPixel, nullptr, nullptr);
+    default:
+      return ReadRgb565<ZEDMD_FORMAT_GRAY8>(pPixel, nullptr, nullptr);
+  }
+}
+
+// Maps a pixel of a frame with the given number of shades onto the palette, the shades are spread over the whole
+// palette and higher bits of the pixel are ignored.
+static uint8_t GetPaletteIndex(uint8_t value, uint16_t shades, uint16_t numColors)
+{
+  if (shades >= 256) return value;
+  if (0 == numColors) return 0;
+
+  return (value & (shades - 1)) * (numColors - 1) / (shades - 1);
+}
 
 ZeDMD::ZeDMD()
 {
@@ -20,27 +146,21 @@ ZeDMD::ZeDMD()
 
   m_pZeDMDComm = new ZeDMDComm();
   m_pZeDMDWiFi = new ZeDMDWiFi();
+
+  SetDefaultPalette(4);
 }
 
 ZeDMD::~ZeDMD()
 {
+  // Encodes the frames that are still queued.
+  delete m_pPipeline;
+
   delete m_pZeDMDComm;
   delete m_pZeDMDWiFi;
 
-  if (m_pFrameBuffer)
-  {
-    delete m_pFrameBuffer;
-  }
-
-  if (m_pScaledFrameBuffer)
-  {
-    delete m_pScaledFrameBuffer;
-  }
-
-  if (m_pRgb565Buffer)
-  {
-    delete m_pRgb565Buffer;
-  }
+  free(m_pFrameBuffer);
+  free(m_pScaledFrameBuffer);
+  free(m_pRgb565Buffer);
 }
 
 void ZeDMD::SetLogCallback(ZeDMD_LogCallback callback, const void* userData)
@@ -49,14 +169,22 @@ void ZeDMD::SetLogCallback(ZeDMD_LogCallback callback, const void* userData)
   m_pZeDMDWiFi->SetLogCallback(callback, userData);
 }
 
+void ZeDMD::SetFrameCallback(ZeDMD_FrameCallback callback, const void* userData)
+{
+  m_pZeDMDComm->SetFrameCallback(callback, userData);
+  m_pZeDMDWiFi->SetFrameCallback(callback, userData);
+}
+
 void ZeDMD::Close()
 {
+  WaitForPipeline();
   m_pZeDMDComm->Disconnect();
   m_pZeDMDWiFi->Disconnect();
 }
 
 void ZeDMD::Reset()
 {
+  WaitForPipeline();
   if (m_usb)
   {
     m_pZeDMDComm->SoftReset();
@@ -71,10 +199,97 @@ void ZeDMD::IgnoreDevice(const char* const ignore_device) { m_pZeDMDComm->Ignore
 
 void ZeDMD::SetDevice(const char* const device) { m_pZeDMDComm->SetDevice(device); }
 
+void ZeDMD::SetPalette(const uint8_t* pPalette, uint16_t numColors)
+{
+  WaitForPipeline();
+  if (numColors > 256) numColors = 256;
+
+  // Indices without a color are black.
+  memset(m_palette, 0, sizeof(m_palette));
+  memcpy(m_palette, pPalette, numColors * 3);
+  m_numColors = numColors;
+
+  UpdatePaletteLuts();
+}
+
+void ZeDMD::UpdatePaletteLuts()
+{
+  for (uint16_t i = 0; i < 256; i++)
+  {
+    m_paletteLut[i] = ReadRgb565<ZEDMD_FORMAT_RGB888>(&m_palette[i * 3], nullptr, m_pColorLut);
+  }
+
+  for (uint16_t i = 0; i < 256; i++)
+  {
+    m_gray2Lut[i] = m_paletteLut[GetPaletteIndex(i, 4, m_numColors)];
+    m_gray4Lut[i] = m_paletteLut[GetPaletteIndex(i, 16, m_numColors)];
+  }
+
+  m_paletteChanged = true;
+}
+
+void ZeDMD::SetColorCorrection(float gamma, float redGain, float greenGain, float blueGain, float brightness)
+{
+  if (gamma <= 0.0f) return;
+
+  WaitForPipeline();
+
+  const float gains[3] = {redGain * brightness, greenGain * brightness, blueGain * brightness};
+  bool identity = true;
+  for (uint8_t channel = 0; channel < 3; channel++)
+  {
+    for (uint16_t i = 0; i < 256; i++)
+    {
+      float corrected = 255.0f * gains[channel] * powf(i / 255.0f, gamma) + 0.5f;
+      uint8_t value = (uint8_t)std::clamp(corrected, 0.0f, 255.0f);
+      identity = identity && (value == i);
+
+      uint16_t rgb565;
+      switch (channel)
+      {
+        case 0:
+          rgb565 = (value & 0xF8) << 8;
+          break;
+        case 1:
+          rgb565 = (value & 0xFC) << 3;
+          break;
+        default:
+          rgb565 = value >> 3;
+          break;
+      }
+      m_colorLut[channel * 256 + i] = rgb565;
+    }
+  }
+
+  // Without a correction, the conversion keeps using the SIMD kernels.
+  m_pColorLut = identity ? nullptr : m_colorLut;
+  m_colorChanged = true;
+  UpdatePaletteLuts();
+}
+
+void ZeDMD::SetDefaultPalette(uint8_t bitDepth)
+{
+  if (bitDepth < 1 || bitDepth > 8) return;
+
+  // Shades of the orange of classic plasma DMDs.
+  uint16_t numColors = 1 << bitDepth;
+  uint8_t palette[256 * 3];
+  for (uint16_t i = 0; i < numColors; i++)
+  {
+    palette[i * 3] = 255 * i / (numColors - 1);
+    palette[i * 3 + 1] = 88 * i / (numColors - 1);
+    palette[i * 3 + 2] = 32 * i / (numColors - 1);
+  }
+
+  SetPalette(palette, numColors);
+}
+
 void ZeDMD::SetFrameSize(uint16_t width, uint16_t height)
 {
+  WaitForPipeline();
   m_romWidth = width;
   m_romHeight = height;
+  UpdateScalingPlan();
 }
 
 uint16_t const ZeDMD::GetWidth()
@@ -104,8 +319,55 @@ bool const ZeDMD::IsS3()
   return m_pZeDMDComm->IsS3();
 }
 
+uint32_t const ZeDMD::GetChunkCacheHits()
+{
+  if (m_wifi)
+  {
+    return m_pZeDMDWiFi->GetChunkCacheHits();
+  }
+  return m_pZeDMDComm->GetChunkCacheHits();
+}
+
+uint32_t const ZeDMD::GetChunkCacheMisses()
+{
+  if (m_wifi)
+  {
+    return m_pZeDMDWiFi->GetChunkCacheMisses();
+  }
+  return m_pZeDMDComm->GetChunkCacheMisses();
+}
+
+float const ZeDMD::GetFps()
+{
+  if (m_wifi)
+  {
+    return m_pZeDMDWiFi->GetFps();
+  }
+  return m_pZeDMDComm->GetFps();
+}
+
+uint32_t const ZeDMD::GetLatency()
+{
+  if (m_wifi)
+  {
+    return m_pZeDMDWiFi->GetLatency();
+  }
+  return m_pZeDMDComm->GetLatency();
+}
+
+uint8_t const ZeDMD::GetQueueDepth()
+{
+  uint8_t depth = m_pPipeline ? m_pPipeline->GetQueueDepth() : 0;
+  if (m_wifi)
+  {
+    return depth + m_pZeDMDWiFi->GetQueueDepth();
+  }
+  return depth + m_pZeDMDComm->GetQueueDepth();
+}
+
 void ZeDMD::LedTest()
 {
+  WaitForPipeline();
   if (m_usb)
   {
     m_pZeDMDComm->QueueCommand(ZEDMD_COMM_COMMAND::LEDTest);
@@ -162,11 +424,52 @@ void ZeDMD::SaveSettings()
 
 void ZeDMD::EnableUpscaling()
 {
+  WaitForPipeline();
   m_upscaling = true;
   m_hd = (GetWidth() == 256);
 }
 
-void ZeDMD::DisableUpscaling() { m_upscaling = false; }
+void ZeDMD::DisableUpscaling()
+{
+  WaitForPipeline();
+  m_upscaling = false;
+}
+
+void ZeDMD::EnableStreamingCompression() { m_pZeDMDComm->SetStreamingCompression(true); }
+
+void ZeDMD::DisableStreamingCompression() { m_pZeDMDComm->SetStreamingCompression(false); }
+
+void ZeDMD::SetFramePacing(uint8_t fps, uint16_t latencyBudget)
+{
+  m_pZeDMDComm->SetFramePacing(fps, latencyBudget);
+  m_pZeDMDWiFi->SetFramePacing(fps, latencyBudget);
+}
+
+void ZeDMD::SetSubmitPolicy(ZEDMD_SUBMIT_POLICY policy)
+{
+  WaitForPipeline();
+  m_submitPolicy = policy;
+  m_pZeDMDComm->SetSubmitPolicy(policy);
+  m_pZeDMDWiFi->SetSubmitPolicy(policy);
+}
+
+void ZeDMD::SetThreadPriority(ZEDMD_THREAD_PRIORITY priority)
+{
+  m_pZeDMDComm->SetThreadPriority(priority);
+  m_pZeDMDWiFi->SetThreadPriority(priority);
+}
+
+void ZeDMD::SetThreadAffinity(uint32_t cpuMask)
+{
+  m_pZeDMDComm->SetThreadAffinity(cpuMask);
+  m_pZeDMDWiFi->SetThreadAffinity(cpuMask);
+}
+
+void ZeDMD::SetThreadName(const char* name)
+{
+  m_pZeDMDComm->SetThreadName(name);
+  m_pZeDMDWiFi->SetThreadName(name);
+}
 
 void ZeDMD::SetWiFiSSID(const char* const ssid)
 {
@@ -205,9 +508,7 @@ bool ZeDMD::OpenWiFi(const char* ip, int port)
     uint16_t height = m_pZeDMDWiFi->GetHeight();
     m_hd = (width == 256);
 
-    m_pFrameBuffer = (uint8_t*)malloc(ZEDMD_MAX_WIDTH * ZEDMD_MAX_HEIGHT * 3);
-    m_pScaledFrameBuffer = (uint8_t*)malloc(ZEDMD_MAX_WIDTH * ZEDMD_MAX_HEIGHT * 3);
-    m_pRgb565Buffer = (uint8_t*)malloc(width * height * 2);
+    AllocateFrameBuffers(width, height);
 
     m_pZeDMDWiFi->Run();
   }
@@ -215,6 +516,27 @@ bool ZeDMD::OpenWiFi(const char* ip, int port)
   return m_wifi;
 }
 
+void ZeDMD::AllocateFrameBuffers(uint16_t width, uint16_t height)
+{
+  WaitForPipeline();
+  free(m_pFrameBuffer);
+  free(m_pScaledFrameBuffer);
+  free(m_pRgb565Buffer);
+
+  // All memory of the render path is allocated here, so rendering a frame doesn't allocate.
+  if (m_wifi) m_pZeDMDWiFi->AllocateFrameQueue();
+  else m_pZeDMDComm->AllocateFrameQueue();
+  m_pFrameBuffer = (uint8_t*)malloc(ZEDMD_FRAME_BUFFER_SIZE);
+  // The 2x scalers never produce more pixels than the panel has.
+  m_pScaledFrameBuffer = (uint8_t*)malloc(width * height * 4);
+  m_pRgb565Buffer = (uint8_t*)malloc(width * height * 2);
+  // The frame buffer retains the last frame, which is patched by the region updates.
+  memset(m_pFrameBuffer, 0, ZEDMD_FRAME_BUFFER_SIZE);
+
+  // The borders of the new buffer get cleared by the next scaling plan.
+  m_scalingPlan.frameWidth = 0;
+}
+
 bool ZeDMD::OpenDefaultWiFi() { return OpenWiFi("zedmd-wifi.local", 3333); }
 
 bool ZeDMD::Open()
@@ -227,9 +549,7 @@ bool ZeDMD::Open()
     uint16_t height = m_pZeDMDComm->GetHeight();
     m_hd = (width == 256);
 
-    m_pFrameBuffer = (uint8_t*)malloc(ZEDMD_MAX_WIDTH * ZEDMD_MAX_HEIGHT * 3);
-    m_pScaledFrameBuffer = (uint8_t*)malloc(ZEDMD_MAX_WIDTH * ZEDMD_MAX_HEIGHT * 3);
-    m_pRgb565Buffer = (uint8_t*)malloc(width * height * 2);
+    AllocateFrameBuffers(width, height);
 
     m_pZeDMDComm->Run();
   }
@@ -249,6 +569,7 @@ bool ZeDMD::Open(uint16_t width, uint16_t height)
 
 void ZeDMD::ClearScreen()
 {
+  WaitForPipeline();
   if (m_usb)
   {
     m_pZeDMDComm->QueueCommand(ZEDMD_COMM_COMMAND::ClearScreen);
@@ -258,179 +579,779 @@ void ZeDMD::ClearScreen()
     m_pZeDMDWiFi->QueueCommand(ZEDMD_COMM_COMMAND::ClearScreen);
   }
   // "Blank" the frame buffer.
-  memset(m_pFrameBuffer, 0, ZEDMD_MAX_WIDTH * ZEDMD_MAX_HEIGHT * 3);
+  memset(m_pFrameBuffer, 0, ZEDMD_FRAME_BUFFER_SIZE);
+  m_frameFormat = ZEDMD_FORMAT_RGB888;
+  m_rgb565Valid = false;
 }
 
-void ZeDMD::RenderRgb888(uint8_t* pFrame)
+void ZeDMD::RenderRgb888(uint8_t* pFrame) { RenderFrame(pFrame, ZEDMD_FORMAT_RGB888); }
+
+void ZeDMD::RenderRgb565(uint16_t* pFrame) { RenderFrame((const uint8_t*)pFrame, ZEDMD_FORMAT_RGB565); }
+
+void ZeDMD::RenderRgb565Region(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint16_t* pFrame,
+                               uint32_t pitch)
 {
-  if (!(m_usb || m_wifi) || !UpdateFrameBuffer888(pFrame))
+  SubmitRegion(x, y, width, height, (const uint8_t*)pFrame, ZEDMD_FORMAT_RGB565, pitch);
+}
+
+void ZeDMD::RenderRgb888Region(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint8_t* pFrame,
+                               uint32_t pitch)
+{
+  SubmitRegion(x, y, width, height, pFrame, ZEDMD_FORMAT_RGB888, pitch);
+}
+
+void ZeDMD::RenderGray2(uint8_t* pFrame) { SubmitFrame(pFrame, ZEDMD_FORMAT_INDEXED8, 0, m_gray2Lut, 0); }
+
+void ZeDMD::RenderGray4(uint8_t* pFrame) { SubmitFrame(pFrame, ZEDMD_FORMAT_INDEXED8, 0, m_gray4Lut, 0); }
+
+void ZeDMD::RenderIndexed8(uint8_t* pFrame) { SubmitFrame(pFrame, ZEDMD_FORMAT_INDEXED8, 0, m_paletteLut, 0); }
+
+void ZeDMD::RenderFrame(const uint8_t* pFrame, ZEDMD_FRAME_FORMAT format, uint32_t pitch)
+{
+  SubmitFrame(pFrame, format, pitch, (ZEDMD_FORMAT_INDEXED8 == format) ? m_paletteLut : nullptr, 0);
+}
+
+uint32_t ZeDMD::RenderRgb888Async(uint8_t* pFrame) { return RenderFrameAsync(pFrame, ZEDMD_FORMAT_RGB888); }
+
+uint32_t ZeDMD::RenderRgb565Async(uint16_t* pFrame)
+{
+  return RenderFrameAsync((const uint8_t*)pFrame, ZEDMD_FORMAT_RGB565);
+}
+
+uint32_t ZeDMD::RenderFrameAsync(const uint8_t* pFrame, ZEDMD_FRAME_FORMAT format, uint32_t pitch)
+{
+  if (!(m_usb || m_wifi))
+  {
+    return 0;
+  }
+
+  // 0 is no valid ticket.
+  if (0 == ++m_ticket) m_ticket = 1;
+
+  const uint16_t* pPaletteLut = (ZEDMD_FORMAT_INDEXED8 == format) ? m_paletteLut : nullptr;
+  return SubmitFrame(pFrame, format, pitch, pPaletteLut, m_ticket) ? m_ticket : 0;
+}
+
+bool ZeDMD::TryRenderRgb888(uint8_t* pFrame) { return TryRenderFrame(pFrame, ZEDMD_FORMAT_RGB888); }
+
+bool ZeDMD::TryRenderRgb565(uint16_t* pFrame)
+{
+  return TryRenderFrame((const uint8_t*)pFrame, ZEDMD_FORMAT_RGB565);
+}
+
+bool ZeDMD::TryRenderFrame(const uint8_t* pFrame, ZEDMD_FRAME_FORMAT format, uint32_t pitch)
+{
+  ZeDMDComm* pComm = m_wifi ? m_pZeDMDWiFi : (m_usb ? m_pZeDMDComm : nullptr);
+  if (!pComm || pComm->IsBehind() || (m_pPipeline && m_pPipeline->IsFull()))
+  {
+    return false;
+  }
+
+  RenderFrame(pFrame, format, pitch);
+  return true;
+}
+
+bool ZeDMD::SubmitFrame(const uint8_t* pFrame, ZEDMD_FRAME_FORMAT format, uint32_t pitch,
+                        const uint16_t* pPaletteLut, uint32_t ticket)
+{
+  ZeDMDRenderJob job;
+  job.pData = pFrame;
+  job.pitch = pitch;
+  job.format = format;
+  job.pPaletteLut = pPaletteLut;
+  job.ticket = ticket;
+
+  return Submit(&job);
+}
+
+void ZeDMD::SubmitRegion(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint8_t* pData,
+                         ZEDMD_FRAME_FORMAT format, uint32_t pitch)
+{
+  if (x >= m_romWidth || y >= m_romHeight)
   {
     return;
   }
 
-  int bufferSize = Scale888(m_pScaledFrameBuffer, m_pFrameBuffer, 3);
-  int rgb565Size = bufferSize / 3;
-  for (uint16_t i = 0; i < rgb565Size; i++)
+  ZeDMDRenderJob job;
+  job.pData = pData;
+  job.pitch = (0 == pitch) ? width * GetBytesPerPixel(format) : pitch;
+  job.format = format;
+  job.region = true;
+  job.x = x;
+  job.y = y;
+  job.width = std::min<uint16_t>(width, m_romWidth - x);
+  job.height = std::min<uint16_t>(height, m_romHeight - y);
+
+  Submit(&job);
+}
+
+bool ZeDMD::Submit(ZeDMDRenderJob* pJob)
+{
+  if (!(m_usb || m_wifi))
   {
-    uint16_t tmp = (((uint16_t)(m_pScaledFrameBuffer[i * 3] & 0xF8)) << 8) |
-                   (((uint16_t)(m_pScaledFrameBuffer[i * 3 + 1] & 0xFC)) << 3) | (m_pScaledFrameBuffer[i * 3 + 2] >> 3);
-    m_pRgb565Buffer[i * 2 + 1] = tmp >> 8;
-    m_pRgb565Buffer[i * 2] = tmp & 0xFF;
+    return false;
   }
 
-  if (m_wifi)
+  if (!m_pPipeline)
   {
-    m_pZeDMDWiFi->QueueFrame(m_pRgb565Buffer, rgb565Size * 2);
+    return Encode(pJob);
   }
-  else if (m_usb)
+
+  ZeDMDComm* pComm = m_wifi ? m_pZeDMDWiFi : m_pZeDMDComm;
+  uint32_t superseded;
+  ZeDMDRenderJob* pQueued = m_pPipeline->AcquireJob(m_submitPolicy, pJob->region, &superseded);
+  if (superseded) pComm->SupersedeTicket(superseded);
+  if (!pQueued)
+  {
+    return false;
+  }
+
+  // Handing off the frame is just a copy, everything else is done by the encode stage.
+  const uint32_t rowBytes = (pJob->region ? pJob->width : m_romWidth) * GetBytesPerPixel(pJob->format);
+  const uint16_t rows = pJob->region ? pJob->height : m_romHeight;
+  const uint32_t pitch = (0 == pJob->pitch) ? rowBytes : pJob->pitch;
+  uint8_t* pBuffer = pQueued->pBuffer;
+  if (pitch == rowBytes)
   {
-    m_pZeDMDComm->QueueFrame(m_pRgb565Buffer, rgb565Size * 2);
+    memcpy(pBuffer, pJob->pData, rowBytes * rows);
+  }
+  else
+  {
+    for (uint16_t row = 0; row < rows; row++)
+    {
+      memcpy(&pBuffer[row * rowBytes], &pJob->pData[row * pitch], rowBytes);
+    }
   }
+
+  *pQueued = *pJob;
+  pQueued->pBuffer = pBuffer;
+  pQueued->pData = pBuffer;
+  pQueued->pitch = rowBytes;
+  m_pPipeline->SubmitJob();
+
+  return true;
 }
 
-void ZeDMD::RenderRgb565(uint16_t* pFrame)
+bool ZeDMD::Encode(ZeDMDRenderJob* pJob)
 {
-  if (!(m_usb || m_wifi) || !UpdateFrameBuffer565(pFrame))
+  ZeDMDComm* pComm = m_wifi ? m_pZeDMDWiFi : m_pZeDMDComm;
+
+  // A dropped frame is not retained, so the next one is compared to the last frame that was queued. A region can't
+  // be dropped, since the pixels it patches wouldn't be rendered again. It is coalesced into the dirty zones instead.
+  if (!AcceptFrame() && !pJob->region)
   {
-    return;
+    // Frames dropped by the render pipeline already got their ticket.
+    if (m_pPipeline && pJob->ticket) pComm->SupersedeTicket(pJob->ticket);
+    return false;
   }
 
-  int size = Scale565(m_pScaledFrameBuffer, pFrame, is_bigendian());
+  if (pJob->pPaletteLut) SelectPaletteLut(pJob->pPaletteLut);
+
+  // The ticket is attached to the frame queued for it. If the frame doesn't change the zones, the ticket completes
+  // with the frame that is already pending.
+  if (pJob->ticket) pComm->BeginTicket(pJob->ticket);
+  if (pJob->region)
+  {
+    RenderRegion(pJob->x, pJob->y, pJob->width, pJob->height, pJob->pData, pJob->format, pJob->pitch);
+  }
+  else
+  {
+    // A frame the pipeline owns is exchanged with the frame buffer instead of being copied into it.
+    Render(pJob->pData, pJob->format, pJob->pitch, pJob->pBuffer ? &pJob->pBuffer : nullptr);
+  }
+  if (pJob->ticket) pComm->EndTicket();
+
+  return true;
+}
+
+void ZeDMD::EnableRenderPipeline()
+{
+  if (!m_pPipeline)
+  {
+    m_pPipeline = new ZeDMDPipeline([this](ZeDMDRenderJob* pJob) { Encode(pJob); }, ZEDMD_FRAME_BUFFER_SIZE);
+  }
+}
+
+void ZeDMD::DisableRenderPipeline()
+{
+  // Encodes the frames that are still queued.
+  delete m_pPipeline;
+  m_pPipeline = nullptr;
+}
+
+uint8_t* ZeDMD::AcquireBackBuffer() { return m_pPipeline ? m_pPipeline->AcquireBackBuffer() : nullptr; }
+
+uint32_t ZeDMD::PublishBackBuffer(ZEDMD_FRAME_FORMAT format)
+{
+  if (!m_pPipeline || !(m_usb || m_wifi))
+  {
+    return 0;
+  }
+
+  // 0 is no valid ticket.
+  if (0 == ++m_ticket) m_ticket = 1;
+
+  ZeDMDRenderJob job;
+  job.format = format;
+  job.pPaletteLut = (ZEDMD_FORMAT_INDEXED8 == format) ? m_paletteLut : nullptr;
+  job.ticket = m_ticket;
+
+  ZeDMDComm* pComm = m_wifi ? m_pZeDMDWiFi : m_pZeDMDComm;
+  uint32_t superseded = m_pPipeline->PublishBackBuffer(&job);
+  if (superseded) pComm->SupersedeTicket(superseded);
+
+  return m_ticket;
+}
+
+void ZeDMD::WaitForPipeline()
+{
+  if (m_pPipeline)
+  {
+    m_pPipeline->Flush();
+  }
+}
 
+bool ZeDMD::AcceptFrame()
+{
   if (m_wifi)
   {
-    m_pZeDMDWiFi->QueueFrame(m_pScaledFrameBuffer, size);
+    return m_pZeDMDWiFi->AcceptFrame();
   }
-  else if (m_usb)
+  return m_pZeDMDComm->AcceptFrame();
+}
+
+void ZeDMD::SelectPaletteLut(const uint16_t* pPaletteLut)
+{
+  // The same indices need to be rendered again if they are looked up in a different table.
+  if (m_pPaletteLut != pPaletteLut)
   {
-    m_pZeDMDComm->QueueFrame(m_pScaledFrameBuffer, size);
+    m_pPaletteLut = pPaletteLut;
+    m_paletteChanged = true;
   }
 }
-bool ZeDMD::UpdateFrameBuffer888(uint8_t* pFrame)
+
+void ZeDMD::Render(const uint8_t* pFrame, ZEDMD_FRAME_FORMAT format, uint32_t pitch, uint8_t** ppBuffer)
 {
-  if (0 == memcmp(m_pFrameBuffer, pFrame, m_romWidth * m_romHeight * 3))
+  const uint32_t rowBytes = m_romWidth * GetBytesPerPixel(format);
+  if (0 == pitch) pitch = rowBytes;
+
+  bool changed = UpdateFrameBuffer(pFrame, rowBytes, pitch, ppBuffer);
+  if (ZEDMD_FORMAT_INDEXED8 == format && m_paletteChanged)
   {
-    return false;
+    m_paletteChanged = false;
+    changed = true;
   }
 
-  memcpy(m_pFrameBuffer, pFrame, m_romWidth * m_romHeight * 3);
-  return true;
+  if (m_colorChanged)
+  {
+    m_colorChanged = false;
+    changed = true;
+  }
+
+  // The same bytes are a different frame in another format.
+  if (format != m_frameFormat)
+  {
+    m_frameFormat = format;
+    changed = true;
+  }
+
+  if (!changed)
+  {
+    return;
+  }
+
+  // Padded rows are packed into the frame buffer by UpdateFrameBuffer().
+  const uint8_t* pPacked = (pitch == rowBytes) ? pFrame : m_pFrameBuffer;
+  UpdateScalingPlan();
+  QueueRgb565(pPacked, format, 0, 0, m_scalingPlan.frameWidth, m_scalingPlan.frameHeight);
 }
 
-bool ZeDMD::UpdateFrameBuffer565(uint16_t* pFrame)
+void ZeDMD::RenderRegion(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint8_t* pData,
+                         ZEDMD_FRAME_FORMAT format, uint32_t pitch)
 {
-  if (0 == memcmp(m_pFrameBuffer, pFrame, m_romWidth * m_romHeight * 2))
+  if (x >= m_romWidth || y >= m_romHeight)
   {
-    return false;
+    return;
   }
 
-  memcpy(m_pFrameBuffer, pFrame, m_romWidth * m_romHeight * 2);
-  return true;
+  const uint8_t bytes = GetBytesPerPixel(format);
+  if (0 == pitch) pitch = width * bytes;
+  width = std::min<uint16_t>(width, m_romWidth - x);
+  height = std::min<uint16_t>(height, m_romHeight - y);
+
+  // Indices looked up in a changed palette, a new color correction and a new scaling plan change pixels outside of
+  // the region, too.
+  bool full =
+      UpdateScalingPlan() || m_colorChanged || (ZEDMD_FORMAT_INDEXED8 == m_frameFormat && m_paletteChanged);
+  if (format != m_frameFormat)
+  {
+    ConvertFrameBuffer(format);
+  }
+
+  // Patch the retained frame, without looking at the rows outside of the region.
+  const uint32_t frameRowBytes = m_romWidth * bytes;
+  bool changed = false;
+  for (uint16_t row = 0; row < height; row++)
+  {
+    uint8_t* pRow = &m_pFrameBuffer[(y + row) * frameRowBytes + x * bytes];
+    if (0 != memcmp(pRow, &pData[row * pitch], width * bytes))
+    {
+      memcpy(pRow, &pData[row * pitch], width * bytes);
+      changed = true;
+    }
+  }
+
+  if (full)
+  {
+    m_paletteChanged = false;
+    m_colorChanged = false;
+    QueueRgb565(m_pFrameBuffer, format, 0, 0, m_scalingPlan.frameWidth, m_scalingPlan.frameHeight);
+    return;
+  }
+
+  if (!changed)
+  {
+    return;
+  }
+
+  // Map the region onto the panel, including the neighboring pixels the scalers look at.
+  const ScalingPlan& plan = m_scalingPlan;
+  uint16_t left, top, right, bottom;
+  if (1 == plan.mode)
+  {
+    left = x / 2;
+    top = y / 2;
+    right = (x + width + 1) / 2;
+    bottom = (y + height + 1) / 2;
+  }
+  else if (2 == plan.mode)
+  {
+    left = (x > 0 ? x - 1 : 0) * 2;
+    top = (y > 0 ? y - 1 : 0) * 2;
+    right = std::min<uint16_t>(x + width + 1, m_romWidth) * 2;
+    bottom = std::min<uint16_t>(y + height + 1, m_romHeight) * 2;
+  }
+  else
+  {
+    left = x * plan.width / m_romWidth;
+    top = y * plan.height / m_romHeight;
+    right = ((x + width) * plan.width + m_romWidth - 1) / m_romWidth;
+    bottom = ((y + height) * plan.height + m_romHeight - 1) / m_romHeight;
+  }
+
+  right = std::min(right, plan.width);
+  bottom = std::min(bottom, plan.height);
+  QueueRgb565(m_pFrameBuffer, format, plan.xOffset + left, plan.yOffset + top, right - left, bottom - top);
 }
 
-uint8_t ZeDMD::GetScaleMode(uint16_t frameWidth, uint16_t frameHeight, uint8_t* pXOffset, uint8_t* pYOffset)
+void ZeDMD::QueueRgb565(const uint8_t* pFrame, ZEDMD_FRAME_FORMAT format, uint16_t x, uint16_t y, uint16_t width,
+                        uint16_t height)
 {
-  if (m_romWidth == 192 && frameWidth == 256)
+  uint8_t* pRgb565 = m_pRgb565Buffer;
+  int size;
+
+  // On little endian hosts, an unscaled RGB565 frame is already in the format ZeDMD expects, so it is passed through.
+  if (ZEDMD_FORMAT_RGB565 == format && std::endian::native == std::endian::little &&
+      m_scalingPlan.passthrough && !m_pColorLut)
   {
-    (*pXOffset) = 32;
-    return 0;
+    pRgb565 = (uint8_t*)pFrame;
+    size = m_romWidth * m_romHeight * 2;
+    m_rgb565Valid = false;
   }
-  else if (m_romWidth == 192 && frameWidth == 128)
+  else
   {
-    (*pXOffset) = 16;
-    return 1;
+    // As long as the RGB565 buffer holds the rest of the frame, only the pixels of a region are scaled and converted.
+    const ScalingPlan& plan = m_scalingPlan;
+    uint16_t left = 0, top = 0, right = plan.width, bottom = plan.height;
+    if (m_rgb565Valid)
+    {
+      left = std::clamp<int>(x - plan.xOffset, 0, plan.width);
+      top = std::clamp<int>(y - plan.yOffset, 0, plan.height);
+      right = std::clamp<int>(x + width - plan.xOffset, left, plan.width);
+      bottom = std::clamp<int>(y + height - plan.yOffset, top, plan.height);
+    }
+    size = ScaleToRgb565(pFrame, format, left, top, right, bottom);
+    m_rgb565Valid = true;
   }
-  else if (m_romHeight == 16 && frameHeight == 32)
+
+  if (m_wifi)
   {
-    (*pYOffset) = 8;
-    return 0;
+    m_pZeDMDWiFi->QueueFrame(pRgb565, size, x, y, width, height);
   }
-  else if (m_romHeight == 16 && frameHeight == 64)
+  else if (m_usb)
+  {
+    m_pZeDMDComm->QueueFrame(pRgb565, size, x, y, width, height);
+  }
+}
+
+void ZeDMD::ConvertFrameBuffer(ZEDMD_FRAME_FORMAT format)
+{
+  const uint8_t fromBytes = GetBytesPerPixel(m_frameFormat);
+  const uint8_t toBytes = GetBytesPerPixel(format);
+  const uint32_t pixels = m_romWidth * m_romHeight;
+
+  // Converted in place, so growing pixels are converted starting at the end of the frame.
+  for (uint32_t n = 0; n < pixels; n++)
   {
-    if (m_upscaling)
+    uint32_t i = (toBytes > fromBytes) ? pixels - 1 - n : n;
+    uint16_t rgb565;
+    if (ZEDMD_FORMAT_INDEXED8 == m_frameFormat)
     {
-      (*pYOffset) = 16;
-      return 2;
+      // The retained frame holds the colors before the color correction.
+      uint16_t shades = (m_pPaletteLut == m_gray2Lut) ? 4 : ((m_pPaletteLut == m_gray4Lut) ? 16 : 256);
+      uint8_t index = GetPaletteIndex(m_pFrameBuffer[i], shades, m_numColors);
+      rgb565 = ReadRgb565<ZEDMD_FORMAT_RGB888>(&m_palette[index * 3], nullptr, nullptr);
+    }
+    else
+    {
+      rgb565 = ReadRgb565(&m_pFrameBuffer[i * fromBytes], m_frameFormat);
+    }
+    uint8_t* pPixel = &m_pFrameBuffer[i * toBytes];
+    if (ZEDMD_FORMAT_RGB565 == format)
+    {
+      memcpy(pPixel, &rgb565, 2);
+    }
+    else
+    {
+      // Only RGB888 regions are supported besides RGB565.
+      pPixel[0] = ((rgb565 >> 8) & 0xF8) | (rgb565 >> 13);
+      pPixel[1] = ((rgb565 >> 3) & 0xFC) | ((rgb565 >> 9) & 0x03);
+      pPixel[2] = ((rgb565 << 3) & 0xF8) | ((rgb565 >> 2) & 0x07);
     }
-    (*pXOffset) = 64;
-    (*pYOffset) = 24;
-    return 0;
   }
-  else if (m_romWidth == 256 && frameWidth == 128)
+
+  m_frameFormat = format;
+  m_rgb565Valid = false;
+}
+
+bool ZeDMD::UpdateFrameBuffer(const uint8_t* pFrame, uint32_t rowBytes, uint32_t pitch, uint8_t** ppBuffer)
+{
+  if (pitch == rowBytes)
   {
-    return 1;
+    if (0 == memcmp(m_pFrameBuffer, pFrame, rowBytes * m_romHeight))
+    {
+      return false;
+    }
+
+    // The buffer holding the frame becomes the frame buffer, the previous frame buffer takes its place.
+    if (ppBuffer)
+    {
+      std::swap(m_pFrameBuffer, *ppBuffer);
+      return true;
+    }
+
+    memcpy(m_pFrameBuffer, pFrame, rowBytes * m_romHeight);
+    return true;
   }
-  else if (m_romWidth == 128 && frameWidth == 256)
+
+  bool changed = false;
+  for (uint16_t y = 0; y < m_romHeight; y++)
   {
-    if (m_upscaling)
+    uint8_t* pRow = &m_pFrameBuffer[y * rowBytes];
+    if (changed || 0 != memcmp(pRow, &pFrame[y * pitch], rowBytes))
     {
-      return 2;
+      memcpy(pRow, &pFrame[y * pitch], rowBytes);
+      changed = true;
     }
-    (*pXOffset) = 64;
-    (*pYOffset) = 16;
-    return 0;
   }
 
-  return 255;
+  return changed;
 }
 
-int ZeDMD::Scale888(uint8_t* pScaledFrame, uint8_t* pFrame, uint8_t bytes)
+bool ZeDMD::UpdateScalingPlan()
 {
-  uint8_t bits = bytes * 8;
-  uint8_t xoffset = 0;
-  uint8_t yoffset = 0;
   uint16_t frameWidth = GetWidth();
   uint16_t frameHeight = GetHeight();
-  int bufferSize = m_romWidth * m_romHeight * bytes;
-  uint8_t scale = GetScaleMode(frameWidth, frameHeight, &xoffset, &yoffset);
+  ScalingPlan& plan = m_scalingPlan;
 
-  if (scale == 255)
+  if (plan.romWidth == m_romWidth && plan.romHeight == m_romHeight && plan.frameWidth == frameWidth &&
+      plan.frameHeight == frameHeight && plan.upscaling == m_upscaling)
   {
-    memcpy(pScaledFrame, pFrame, bufferSize);
-    return bufferSize;
+    return false;
   }
 
-  bufferSize = frameWidth * frameHeight * bytes;
-  memset(pScaledFrame, 0, bufferSize);
+  plan.romWidth = m_romWidth;
+  plan.romHeight = m_romHeight;
+  plan.frameWidth = frameWidth;
+  plan.frameHeight = frameHeight;
+  plan.upscaling = m_upscaling;
+
+  if (0 == m_romWidth || 0 == m_romHeight || 0 == frameWidth || 0 == frameHeight)
+  {
+    plan.mode = 0;
+    plan.width = plan.height = plan.xOffset = plan.yOffset = 0;
+    plan.passthrough = false;
+    return true;
+  }
 
-  if (scale == 1)
+  bool fits = m_romWidth <= frameWidth && m_romHeight <= frameHeight;
+  if (fits && m_upscaling && m_romWidth * 2 <= frameWidth && m_romHeight * 2 <= frameHeight)
   {
-    FrameUtil::Helper::ScaleDown(pScaledFrame, frameWidth, frameHeight, pFrame, m_romWidth, m_romHeight, bits);
+    // Double the resolution using scale2x, for example 128x32 on 256x64 or 128x16 on 256x64.
+    plan.mode = 2;
+    plan.width = m_romWidth * 2;
+    plan.height = m_romHeight * 2;
   }
-  else if (scale == 2)
+  else if (fits)
   {
-    FrameUtil::Helper::ScaleUp(pScaledFrame, pFrame, m_romWidth, m_romHeight, bits);
-    if (frameWidth > (m_romWidth * 2) || frameHeight > (m_romHeight * 2))
+    plan.mode = 0;
+    plan.width = m_romWidth;
+    plan.height = m_romHeight;
+  }
+  else if (m_romWidth % 2 == 0 && m_romHeight % 2 == 0 && m_romWidth / 2 <= frameWidth &&
+           m_romHeight / 2 <= frameHeight)
+  {
+    // Half the resolution keeping the dominant color of each 2x2 block, for example 256x64 or 192x64 on 128x32.
+    plan.mode = 1;
+    plan.width = m_romWidth / 2;
+    plan.height = m_romHeight / 2;
+  }
+  else
+  {
+    // Any other size is fitted into the panel keeping the aspect ratio.
+    plan.mode = 0;
+    if (frameWidth * m_romHeight <= frameHeight * m_romWidth)
+    {
+      plan.width = frameWidth;
+      plan.height = m_romHeight * frameWidth / m_romWidth;
+    }
+    else
     {
-      uint8_t* pUncenteredFrame = (uint8_t*)malloc(bufferSize);
-      memcpy(pUncenteredFrame, pScaledFrame, bufferSize);
-      FrameUtil::Helper::Center(pScaledFrame, frameWidth, frameHeight, pUncenteredFrame, m_romWidth * 2,
-                                m_romHeight * 2, bits);
-      free(pUncenteredFrame);
+      plan.width = m_romWidth * frameHeight / m_romHeight;
+      plan.height = frameHeight;
     }
   }
+
+  plan.xOffset = (frameWidth - plan.width) / 2;
+  plan.yOffset = (frameHeight - plan.height) / 2;
+  plan.passthrough = (0 == plan.mode && m_romWidth == frameWidth && m_romHeight == frameHeight);
+
+  // The 2x scalers write an uncentered frame of the scaled size, which is then read as it is.
+  uint16_t sourceWidth = (0 == plan.mode) ? m_romWidth : plan.width;
+  uint16_t sourceHeight = (0 == plan.mode) ? m_romHeight : plan.height;
+  for (uint16_t x = 0; x < plan.width; x++)
+  {
+    plan.xSource[x] = x * sourceWidth / plan.width;
+  }
+  for (uint16_t y = 0; y < plan.height; y++)
+  {
+    plan.ySource[y] = y * sourceHeight / plan.height;
+  }
+
+  // Pixels outside the scaled frame are never written, they need to be black.
+  if (m_pRgb565Buffer)
+  {
+    memset(m_pRgb565Buffer, 0, frameWidth * frameHeight * 2);
+  }
+  m_rgb565Valid = false;
+
+  return true;
+}
+
+#if defined(ZEDMD_SSE2)
+template <int shift>
+static inline __m128i ShiftLanes32(__m128i v)
+{
+  if constexpr (shift >= 0)
+    return _mm_slli_epi32(v, shift);
   else
+    return _mm_srli_epi32(v, -shift);
+}
+
+// Converts 4 pixels of a 32 bit format, the result is in the lower 16 bits of each lane.
+template <ZEDMD_FRAME_FORMAT format>
+static inline __m128i ToRgb565x4(__m128i v)
+{
+  using Layout = PixelLayout<format>;
+
+  __m128i red = _mm_and_si128(ShiftLanes32<8 - 8 * Layout::red>(v), _mm_set1_epi32(0xF800));
+  __m128i green = _mm_and_si128(ShiftLanes32<3 - 8 * Layout::green>(v), _mm_set1_epi32(0x07E0));
+  __m128i blue = _mm_and_si128(ShiftLanes32<-3 - 8 * Layout::blue>(v), _mm_set1_epi32(0x001F));
+  v = _mm_or_si128(_mm_or_si128(red, green), blue);
+  // Sign extend, so that the saturating pack keeps all 16 bits.
+  return _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+}
+
+static inline __m128i GrayToRgb565x8(__m128i gray)
+{
+  return _mm_or_si128(_mm_or_si128(_mm_slli_epi16(_mm_and_si128(gray, _mm_set1_epi16(0xF8)), 8),
+                                   _mm_slli_epi16(_mm_and_si128(gray, _mm_set1_epi16(0xFC)), 3)),
+                      _mm_srli_epi16(gray, 3));
+}
+#elif defined(ZEDMD_NEON)
+static inline uint16x8_t ToRgb565x8(uint8x8_t red, uint8x8_t green, uint8x8_t blue)
+{
+  uint16x8_t rgb565 = vshll_n_u8(red, 8);
+  rgb565 = vsriq_n_u16(rgb565, vshll_n_u8(green, 8), 5);
+  return vsriq_n_u16(rgb565, vshll_n_u8(blue, 8), 11);
+}
+#endif
+
+// Converts a row of unscaled pixels to little endian RGB565.
+template <ZEDMD_FRAME_FORMAT format>
+static void ConvertRowRgb565(uint8_t* pTarget, const uint8_t* pRow, uint16_t width, const uint16_t* pPaletteLut,
+                             const uint16_t* pColorLut)
+{
+  using Layout = PixelLayout<format>;
+  uint16_t x = 0;
+  // The color correction is a table lookup per channel, which is done by the pixel loop below.
+  const uint16_t simdWidth = pColorLut ? 0 : width;
+
+  if constexpr (format == ZEDMD_FORMAT_RGB565 && std::endian::native == std::endian::little)
   {
-    FrameUtil::Helper::Center(pScaledFrame, frameWidth, frameHeight, pFrame, m_romWidth, m_romHeight, bits);
+    if (!pColorLut)
+    {
+      memcpy(pTarget, pRow, width * 2);
+      return;
+    }
   }
 
-  return bufferSize;
+#if defined(ZEDMD_SSE2)
+  if constexpr (Layout::bytes == 4)
+  {
+    for (; x + 8 <= simdWidth; x += 8)
+    {
+      __m128i low = ToRgb565x4<format>(_mm_loadu_si128((const __m128i*)&pRow[x * 4]));
+      __m128i high = ToRgb565x4<format>(_mm_loadu_si128((const __m128i*)&pRow[x * 4 + 16]));
+      _mm_storeu_si128((__m128i*)&pTarget[x * 2], _mm_packs_epi32(low, high));
+    }
+  }
+  else if constexpr (format == ZEDMD_FORMAT_GRAY8)
+  {
+    for (; x + 16 <= simdWidth; x += 16)
+    {
+      __m128i gray = _mm_loadu_si128((const __m128i*)&pRow[x]);
+      _mm_storeu_si128((__m128i*)&pTarget[x * 2], GrayToRgb565x8(_mm_unpacklo_epi8(gray, _mm_setzero_si128())));
+      _mm_storeu_si128((__m128i*)&pTarget[x * 2 + 16], GrayToRgb565x8(_mm_unpackhi_epi8(gray, _mm_setzero_si128())));
+    }
+  }
+#elif defined(ZEDMD_NEON)
+  if constexpr (Layout::bytes == 4)
+  {
+    for (; x + 8 <= simdWidth; x += 8)
+    {
+      uint8x8x4_t pixels = vld4_u8(&pRow[x * 4]);
+      vst1q_u16((uint16_t*)&pTarget[x * 2],
+                ToRgb565x8(pixels.val[Layout::red], pixels.val[Layout::green], pixels.val[Layout::blue]));
+    }
+  }
+  else if constexpr (Layout::bytes == 3)
+  {
+    for (; x + 8 <= simdWidth; x += 8)
+    {
+      uint8x8x3_t pixels = vld3_u8(&pRow[x * 3]);
+      vst1q_u16((uint16_t*)&pTarget[x * 2],
+                ToRgb565x8(pixels.val[Layout::red], pixels.val[Layout::green], pixels.val[Layout::blue]));
+    }
+  }
+  else if constexpr (format == ZEDMD_FORMAT_GRAY8)
+  {
+    for (; x + 8 <= simdWidth; x += 8)
+    {
+      uint8x8_t gray = vld1_u8(&pRow[x]);
+      vst1q_u16((uint16_t*)&pTarget[x * 2], ToRgb565x8(gray, gray, gray));
+    }
+  }
+#endif
+
+  for (; x < width; x++)
+  {
+    uint16_t rgb565 = ReadRgb565<format>(&pRow[x * Layout::bytes], pPaletteLut, pColorLut);
+    pTarget[x * 2] = rgb565 & 0xFF;
+    pTarget[x * 2 + 1] = rgb565 >> 8;
+  }
+}
+
+template <ZEDMD_FRAME_FORMAT format>
+void ZeDMD::GatherRgb565(const uint8_t* pSource, uint16_t sourceWidth, uint16_t left, uint16_t top, uint16_t right,
+                         uint16_t bottom)
+{
+  constexpr uint8_t bytes = PixelLayout<format>::bytes;
+  const ScalingPlan& plan = m_scalingPlan;
+
+  for (uint16_t y = top; y < bottom; y++)
+  {
+    const uint8_t* pRow = &pSource[plan.ySource[y] * sourceWidth * bytes];
+    uint8_t* pTarget = &m_pRgb565Buffer[((plan.yOffset + y) * plan.frameWidth + plan.xOffset) * 2];
+    if (plan.width == sourceWidth)
+    {
+      ConvertRowRgb565<format>(&pTarget[left * 2], &pRow[left * bytes], right - left, m_pPaletteLut, m_pColorLut);
+      continue;
+    }
+
+    for (uint16_t x = left; x < right; x++)
+    {
+      uint16_t rgb565 = ReadRgb565<format>(&pRow[plan.xSource[x] * bytes], m_pPaletteLut, m_pColorLut);
+      pTarget[x * 2] = rgb565 & 0xFF;
+      pTarget[x * 2 + 1] = rgb565 >> 8;
+    }
+  }
 }
 
-int ZeDMD::Scale565(uint8_t* pScaledFrame, uint16_t* pFrame, bool bigEndian)
+int ZeDMD::ScaleToRgb565(const uint8_t* pFrame, ZEDMD_FRAME_FORMAT format, uint16_t left, uint16_t top,
+                         uint16_t right, uint16_t bottom)
 {
-  int bufferSize = m_romWidth * m_romHeight;
-  uint8_t* pConvertedFrame = (uint8_t*)malloc(bufferSize * 2);
-  for (int i = 0; i < bufferSize; i++)
+  const ScalingPlan& plan = m_scalingPlan;
+  if (UpdateScalingPlan())
+  {
+    left = top = 0;
+    right = plan.width;
+    bottom = plan.height;
+  }
+  const uint8_t* pSource = pFrame;
+  uint16_t sourceWidth = m_romWidth;
+
+  // The 2x scalers only compare pixels, so the frame is scaled in its own format and byte order.
+  if (plan.mode != 0)
   {
-    pConvertedFrame[i * 2 + !bigEndian] = pFrame[i] >> 8;
-    pConvertedFrame[i * 2 + bigEndian] = pFrame[i] & 0xFF;
+    switch (GetBytesPerPixel(format))
+    {
+      case 1:
+        Scale2x<uint8_t>(plan.mode, m_pScaledFrameBuffer, pFrame, m_romWidth, m_romHeight, left, top, right, bottom);
+        break;
+      case 2:
+        Scale2x<uint16_t>(plan.mode, m_pScaledFrameBuffer, pFrame, m_romWidth, m_romHeight, left, top, right, bottom);
+        break;
+      case 3:
+        Scale2x<Rgb888Pixel>(plan.mode, m_pScaledFrameBuffer, pFrame, m_romWidth, m_romHeight, left, top, right,
+                             bottom);
+        break;
+      default:
+        Scale2x<uint32_t>(plan.mode, m_pScaledFrameBuffer, pFrame, m_romWidth, m_romHeight, left, top, right, bottom);
+        break;
+    }
+
+    pSource = m_pScaledFrameBuffer;
+    sourceWidth = plan.width;
   }
 
-  bufferSize = Scale888(pScaledFrame, pConvertedFrame, 2);
-  free(pConvertedFrame);
+  // Scaling, centering and the conversion to little endian RGB565 are done in a single pass.
+  switch (format)
+  {
+    case ZEDMD_FORMAT_RGB888:
+      GatherRgb565<ZEDMD_FORMAT_RGB888>(pSource, sourceWidth, left, top, right, bottom);
+      break;
+    case ZEDMD_FORMAT_RGB565:
+      GatherRgb565<ZEDMD_FORMAT_RGB565>(pSource, sourceWidth, left, top, right, bottom);
+      break;
+    case ZEDMD_FORMAT_BGRA8888:
+      GatherRgb565<ZEDMD_FORMAT_BGRA8888>(pSource, sourceWidth, left, top, right, bottom);
+      break;
+    case ZEDMD_FORMAT_RGBA8888:
+      GatherRgb565<ZEDMD_FORMAT_RGBA8888>(pSource, sourceWidth, left, top, right, bottom);
+      break;
+    case ZEDMD_FORMAT_ARGB8888:
+      GatherRgb565<ZEDMD_FORMAT_ARGB8888>(pSource, sourceWidth, left, top, right, bottom);
+      break;
+    case ZEDMD_FORMAT_GRAY8:
+      GatherRgb565<ZEDMD_FORMAT_GRAY8>(pSource, sourceWidth, left, top, right, bottom);
+      break;
+    case ZEDMD_FORMAT_INDEXED8:
+      GatherRgb565<ZEDMD_FORMAT_INDEXED8>(pSource, sourceWidth, left, top, right, bottom);
+      break;
+  }
 
-  return bufferSize;
+  return plan.frameWidth * plan.frameHeight * 2;
 }
 
 ZEDMDAPI ZeDMD* ZeDMD_GetInstance() { return new ZeDMD(); }
@@ -452,6 +1373,43 @@ ZEDMDAPI bool ZeDMD_OpenDefaultWiFi(ZeDMD* pZeDMD) { return pZeDMD->OpenDefaultW
 
 ZEDMDAPI void ZeDMD_Close(ZeDMD* pZeDMD) { return pZeDMD->Close(); }
 
+ZEDMDAPI uint32_t ZeDMD_GetChunkCacheHits(ZeDMD* pZeDMD) { return pZeDMD->GetChunkCacheHits(); }
+
+ZEDMDAPI uint32_t ZeDMD_GetChunkCacheMisses(ZeDMD* pZeDMD) { return pZeDMD->GetChunkCacheMisses(); }
+
+ZEDMDAPI float ZeDMD_GetFps(ZeDMD* pZeDMD) { return pZeDMD->GetFps(); }
+
+ZEDMDAPI uint32_t ZeDMD_GetLatency(ZeDMD* pZeDMD) { return pZeDMD->GetLatency(); }
+
+ZEDMDAPI uint8_t ZeDMD_GetQueueDepth(ZeDMD* pZeDMD) { return pZeDMD->GetQueueDepth(); }
+
+ZEDMDAPI void ZeDMD_SetSubmitPolicy(ZeDMD* pZeDMD, ZEDMD_SUBMIT_POLICY policy)
+{
+  return pZeDMD->SetSubmitPolicy(policy);
+}
+
+ZEDMDAPI void ZeDMD_SetThreadPriority(ZeDMD* pZeDMD, ZEDMD_THREAD_PRIORITY priority)
+{
+  return pZeDMD->SetThreadPriority(priority);
+}
+
+ZEDMDAPI void ZeDMD_SetThreadAffinity(ZeDMD* pZeDMD, uint32_t cpuMask) { return pZeDMD->SetThreadAffinity(cpuMask); }
+
+ZEDMDAPI void ZeDMD_SetThreadName(ZeDMD* pZeDMD, const char* name) { return pZeDMD->SetThreadName(name); }
+
+ZEDMDAPI void ZeDMD_SetPalette(ZeDMD* pZeDMD, const uint8_t* palette, uint16_t numColors)
+{
+  return pZeDMD->SetPalette(palette, numColors);
+}
+
+ZEDMDAPI void ZeDMD_SetDefaultPalette(ZeDMD* pZeDMD, uint8_t bitDepth) { return pZeDMD->SetDefaultPalette(bitDepth); }
+
+ZEDMDAPI void ZeDMD_SetColorCorrection(ZeDMD* pZeDMD, float gamma, float redGain, float greenGain, float blueGain,
+                                       float brightness)
+{
+  return pZeDMD->SetColorCorrection(gamma, redGain, greenGain, blueGain, brightness);
+}
+
 ZEDMDAPI void ZeDMD_SetFrameSize(ZeDMD* pZeDMD, uint16_t width, uint16_t height)
 {
   return pZeDMD->SetFrameSize(width, height);
@@ -473,6 +1431,26 @@ ZEDMDAPI void ZeDMD_EnableUpscaling(ZeDMD* pZeDMD) { return pZeDMD->EnableUpscal
 
 ZEDMDAPI void ZeDMD_DisableUpscaling(ZeDMD* pZeDMD) { return pZeDMD->DisableUpscaling(); }
 
+ZEDMDAPI void ZeDMD_EnableStreamingCompression(ZeDMD* pZeDMD) { return pZeDMD->EnableStreamingCompression(); }
+
+ZEDMDAPI void ZeDMD_DisableStreamingCompression(ZeDMD* pZeDMD) { return pZeDMD->DisableStreamingCompression(); }
+
+ZEDMDAPI void ZeDMD_EnableRenderPipeline(ZeDMD* pZeDMD) { return pZeDMD->EnableRenderPipeline(); }
+
+ZEDMDAPI void ZeDMD_DisableRenderPipeline(ZeDMD* pZeDMD) { return pZeDMD->DisableRenderPipeline(); }
+
+ZEDMDAPI uint8_t* ZeDMD_AcquireBackBuffer(ZeDMD* pZeDMD) { return pZeDMD->AcquireBackBuffer(); }
+
+ZEDMDAPI uint32_t ZeDMD_PublishBackBuffer(ZeDMD* pZeDMD, ZEDMD_FRAME_FORMAT format)
+{
+  return pZeDMD->PublishBackBuffer(format);
+}
+
+ZEDMDAPI void ZeDMD_SetFramePacing(ZeDMD* pZeDMD, uint8_t fps, uint16_t latencyBudget)
+{
+  return pZeDMD->SetFramePacing(fps, latencyBudget);
+}
+
 ZEDMDAPI void ZeDMD_SetWiFiSSID(ZeDMD* pZeDMD, const char* const ssid) { return pZeDMD->SetWiFiSSID(ssid); }
 
 ZEDMDAPI void ZeDMD_SetWiFiPassword(ZeDMD* pZeDMD, const char* const password)
@@ -487,3 +1465,50 @@ ZEDMDAPI void ZeDMD_ClearScreen(ZeDMD* pZeDMD) { return pZeDMD->ClearScreen(); }
 ZEDMDAPI void ZeDMD_RenderRgb888(ZeDMD* pZeDMD, uint8_t* frame) { return pZeDMD->RenderRgb888(frame); }
 
 ZEDMDAPI void ZeDMD_RenderRgb565(ZeDMD* pZeDMD, uint16_t* frame) { return pZeDMD->RenderRgb565(frame); }
+
+ZEDMDAPI void ZeDMD_RenderRgb565Region(ZeDMD* pZeDMD, uint16_t x, uint16_t y, uint16_t width, uint16_t height,
+                                       const uint16_t* frame, uint32_t pitch)
+{
+  return pZeDMD->RenderRgb565Region(x, y, width, height, frame, pitch);
+}
+
+ZEDMDAPI void ZeDMD_RenderRgb888Region(ZeDMD* pZeDMD, uint16_t x, uint16_t y, uint16_t width, uint16_t height,
+                                       const uint8_t* frame, uint32_t pitch)
+{
+  return pZeDMD->RenderRgb888Region(x, y, width, height, frame, pitch);
+}
+
+ZEDMDAPI void ZeDMD_RenderGray2(ZeDMD* pZeDMD, uint8_t* frame) { return pZeDMD->RenderGray2(frame); }
+
+ZEDMDAPI void ZeDMD_RenderGray4(ZeDMD* pZeDMD, uint8_t* frame) { return pZeDMD->RenderGray4(frame); }
+
+ZEDMDAPI void ZeDMD_RenderIndexed8(ZeDMD* pZeDMD, uint8_t* frame) { return pZeDMD->RenderIndexed8(frame); }
+
+ZEDMDAPI void ZeDMD_RenderFrame(ZeDMD* pZeDMD, const uint8_t* frame, ZEDMD_FRAME_FORMAT format, uint32_t pitch)
+{
+  return pZeDMD->RenderFrame(frame, format, pitch);
+}
+
+ZEDMDAPI void ZeDMD_SetFrameCallback(ZeDMD* pZeDMD, ZeDMD_FrameCallback callback, const void* userData)
+{
+  return pZeDMD->SetFrameCallback(callback, userData);
+}
+
+ZEDMDAPI uint32_t ZeDMD_RenderRgb888Async(ZeDMD* pZeDMD, uint8_t* frame) { return pZeDMD->RenderRgb888Async(frame); }
+
+ZEDMDAPI uint32_t ZeDMD_RenderRgb565Async(ZeDMD* pZeDMD, uint16_t* frame) { return pZeDMD->RenderRgb565Async(frame); }
+
+ZEDMDAPI uint32_t ZeDMD_RenderFrameAsync(ZeDMD* pZeDMD, const uint8_t* frame, ZEDMD_FRAME_FORMAT format,
+                                         uint32_t pitch)
+{
+  return pZeDMD->RenderFrameAsync(frame, format, pitch);
+}
+
+ZEDMDAPI bool ZeDMD_TryRenderRgb888(ZeDMD* pZeDMD, uint8_t* frame) { return pZeDMD->TryRenderRgb888(frame); }
+
+ZEDMDAPI bool ZeDMD_TryRenderRgb565(ZeDMD* pZeDMD, uint16_t* frame) { return pZeDMD->TryRenderRgb565(frame); }
+
+ZEDMDAPI bool ZeDMD_TryRenderFrame(ZeDMD* pZeDMD, const uint8_t* frame, ZEDMD_FRAME_FORMAT format, uint32_t pitch)
+{
+  return pZeDMD->TryRenderFrame(frame, format, pitch);
+}
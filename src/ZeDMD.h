@@ -33,9 +33,77 @@
 
 #include <cstdio>
 
+/** @brief Pixel formats accepted by ZeDMD::RenderFrame()
+ *
+ *  The 32 bit formats are named by the order of their bytes in memory, the
+ *  alpha or padding byte is ignored. RGB565 pixels are in host byte order.
+ *  Indexed pixels are looked up in the palette, see ZeDMD::SetPalette().
+ */
+typedef enum
+{
+  ZEDMD_FORMAT_RGB888 = 0,
+  ZEDMD_FORMAT_RGB565 = 1,
+  ZEDMD_FORMAT_BGRA8888 = 2,
+  ZEDMD_FORMAT_RGBA8888 = 3,
+  ZEDMD_FORMAT_ARGB8888 = 4,
+  ZEDMD_FORMAT_GRAY8 = 5,
+  ZEDMD_FORMAT_INDEXED8 = 6,
+} ZEDMD_FRAME_FORMAT;
+
+/** @brief Completion states of a frame rendered by one of the Async functions
+ *
+ *  ZEDMD_STATUS_ACKNOWLEDGED: all zones of the frame have been sent to ZeDMD
+ *  and acknowledged, or the frame didn't change anything on the display.
+ *  ZEDMD_STATUS_SUPERSEDED: the frame was replaced by a newer frame before it
+ *  was sent completely.
+ *  ZEDMD_STATUS_FAILED: sending the frame failed or the connection got lost.
+ *  @see ZeDMD::SetFrameCallback()
+ */
+typedef enum
+{
+  ZEDMD_STATUS_ACKNOWLEDGED = 0,
+  ZEDMD_STATUS_SUPERSEDED = 1,
+  ZEDMD_STATUS_FAILED = 2,
+} ZEDMD_FRAME_STATUS;
+
+/** @brief Submission policies of ZeDMD::SetSubmitPolicy()
+ *
+ *  ZEDMD_POLICY_LATEST_WINS: frames are never rejected. While ZeDMD is
+ *  behind, the changed zones of the frames are coalesced and only their
+ *  latest content is sent.
+ *  ZEDMD_POLICY_BLOCK: rendering waits until ZeDMD has caught up.
+ *  ZEDMD_POLICY_FAIL_FAST: frames rendered while ZeDMD is behind are dropped.
+ *  Regions are never dropped or replaced, since the rest of the frame isn't
+ *  rendered again. If the render pipeline is full, they wait for it.
+ */
+typedef enum
+{
+  ZEDMD_POLICY_LATEST_WINS = 0,
+  ZEDMD_POLICY_BLOCK = 1,
+  ZEDMD_POLICY_FAIL_FAST = 2,
+} ZEDMD_SUBMIT_POLICY;
+
+/** @brief Priorities of the thread sending the frames, see ZeDMD::SetThreadPriority()
+ *
+ *  ZEDMD_PRIORITY_HIGH: a lower nice value on Linux and Android, the user
+ *  interactive quality of service class on Apple platforms and the highest
+ *  priority on Windows.
+ *  ZEDMD_PRIORITY_REALTIME: the SCHED_FIFO scheduling policy, or the time
+ *  critical priority on Windows.
+ */
+typedef enum
+{
+  ZEDMD_PRIORITY_NORMAL = 0,
+  ZEDMD_PRIORITY_HIGH = 1,
+  ZEDMD_PRIORITY_REALTIME = 2,
+} ZEDMD_THREAD_PRIORITY;
+
 typedef void(ZEDMDCALLBACK* ZeDMD_LogCallback)(const char* format, va_list args, const void* userData);
+typedef void(ZEDMDCALLBACK* ZeDMD_FrameCallback)(uint32_t ticket, ZEDMD_FRAME_STATUS status, const void* userData);
 
 class ZeDMDComm;
+class ZeDMDPipeline;
+struct ZeDMDRenderJob;
 class ZeDMDWiFi;
 
 class ZEDMDAPI ZeDMD
@@ -46,6 +114,20 @@ class ZEDMDAPI ZeDMD
 
   void SetLogCallback(ZeDMD_LogCallback callback, const void* userData);
 
+  /** @brief Set the callback for frames rendered asynchronously
+   *
+   *  The callback is called once for every ticket returned by one of the
+   *  Async functions. It is called by the thread sending the frames to
+   *  ZeDMD or, if a frame is superseded, by the thread rendering the newer
+   *  frame. The callback must not render frames itself.
+   *  Over WiFi, a frame is considered acknowledged once it is sent.
+   *  @see RenderFrameAsync()
+   *
+   *  @param callback the callback, nullptr to remove it
+   *  @param userData passed to the callback
+   */
+  void SetFrameCallback(ZeDMD_FrameCallback callback, const void* userData);
+
   /** @brief Ignore a serial device when searching for ZeDMD
    *
    *  While searching for a ZeDMD any serial ports are tested.
@@ -177,6 +259,54 @@ class ZEDMDAPI ZeDMD
    */
   bool const IsS3();
 
+  /** @brief Get the chunk cache hits
+   *
+   *  Compressed zone chunks are cached, so identical chunks of
+   *  looping animations don't need to be compressed again.
+   *  @see GetChunkCacheMisses()
+   *
+   *  @return the number of chunks taken from the cache
+   */
+  uint32_t const GetChunkCacheHits();
+
+  /** @brief Get the chunk cache misses
+   *
+   *  @see GetChunkCacheHits()
+   *
+   *  @return the number of chunks that needed to be compressed
+   */
+  uint32_t const GetChunkCacheMisses();
+
+  /** @brief Get the achieved frame rate
+   *
+   *  @see SetFramePacing()
+   *
+   *  @return the frames per second sent to ZeDMD during the last second
+   */
+  float const GetFps();
+
+  /** @brief Get the frame latency
+   *
+   *  The time from rendering a frame until it is sent to ZeDMD,
+   *  smoothed over the last frames.
+   *  @see SetFramePacing()
+   *
+   *  @return the latency in microseconds
+   */
+  uint32_t const GetLatency();
+
+  /** @brief Get the number of frames waiting to be sent
+   *
+   *  ZeDMD is behind once 8 frames are waiting, or earlier if a frame
+   *  would exceed the latency budget.
+   *  A render loop could use this to adapt its frame rate.
+   *  @see SetSubmitPolicy()
+   *  @see SetFramePacing()
+   *
+   *  @return the number of queued frames
+   */
+  uint8_t const GetQueueDepth();
+
   /** @brief Test the panels attached to ZeDMD
    *
    *  Renders a sequence of full red, full green and full blue frames.
@@ -272,6 +402,128 @@ class ZEDMDAPI ZeDMD
    */
   void DisableUpscaling();
 
+  /** @brief Enable streaming compression
+   *
+   *  If enabled and supported by the firmware, all chunks of a frame
+   *  get compressed as one deflate stream. That reduces the bytes
+   *  per frame, especially on 256x64 panels. Only available for USB
+   *  connections, WiFi keeps compressing each chunk on its own.
+   */
+  void EnableStreamingCompression();
+
+  /** @brief Disable streaming compression
+   *
+   *  @see EnableStreamingCompression()
+   */
+  void DisableStreamingCompression();
+
+  /** @brief Enable the render pipeline
+   *
+   *  By default, a frame is palette mapped, color corrected, scaled,
+   *  converted, split into zones and encoded by the thread that renders
+   *  it. With the render pipeline, the rendering functions just copy the
+   *  frame and return, the CPU work is done by an encode thread.
+   *  The pipeline queues up to 2 frames. A full pipeline is handled like a
+   *  ZeDMD that is behind, according to the submission policy.
+   *  Changing a setting that affects the rendering, like the palette or the
+   *  frame size, waits until the queued frames are encoded.
+   *  @see SetSubmitPolicy()
+   */
+  void EnableRenderPipeline();
+
+  /** @brief Disable the render pipeline
+   *
+   *  The queued frames are encoded before this function returns.
+   *  @see EnableRenderPipeline()
+   */
+  void DisableRenderPipeline();
+
+  /** @brief Get the back buffer of the render pipeline
+   *
+   *  Instead of passing a frame to a rendering function, which copies it,
+   *  a frame could be drawn directly into the back buffer and handed off
+   *  with PublishBackBuffer(). The buffer holds a packed frame of the
+   *  frame size in any format and its content is undefined, the frame has
+   *  to be drawn completely.
+   *  The back buffer changes with every published frame, so it has to be
+   *  requested again for the next one.
+   *  @see PublishBackBuffer()
+   *  @see EnableRenderPipeline()
+   *
+   *  @return the back buffer, nullptr if the render pipeline is disabled
+   */
+  uint8_t* AcquireBackBuffer();
+
+  /** @brief Publish the back buffer
+   *
+   *  Hands off the frame drawn into the back buffer to the render pipeline
+   *  without copying or waiting. The pipeline always encodes the latest
+   *  published frame, a frame that hasn't been picked up yet is superseded
+   *  by the next one, regardless of the submission policy. Frames passed to
+   *  the rendering functions are encoded first.
+   *  Indexed frames are looked up in the current palette.
+   *  @see AcquireBackBuffer()
+   *  @see SetFrameCallback()
+   *
+   *  @param format the format of the frame
+   *  @return the ticket of the frame, 0 if it wasn't published
+   */
+  uint32_t PublishBackBuffer(ZEDMD_FRAME_FORMAT format);
+
+  /** @brief Set the frame pacing
+   *
+   *  Frames are sent to ZeDMD at the target frame rate at most. A frame
+   *  which wouldn't be sent within the latency budget isn't queued, its
+   *  changed zones are superseded by the ones of newer frames instead.
+   *  Without pacing, frames are sent as fast as they are rendered.
+   *  @see GetFps()
+   *  @see GetLatency()
+   *
+   *  @param fps the target frame rate, 0 to disable the pacing
+   *  @param latencyBudget the latency budget in milliseconds, 0 for none
+   */
+  void SetFramePacing(uint8_t fps, uint16_t latencyBudget);
+
+  /** @brief Set the submission policy
+   *
+   *  Defines what happens to frames rendered while ZeDMD is behind.
+   *  The default is ZEDMD_POLICY_LATEST_WINS.
+   *  @see TryRenderFrame()
+   *  @see GetQueueDepth()
+   *
+   *  @param policy the submission policy
+   */
+  void SetSubmitPolicy(ZEDMD_SUBMIT_POLICY policy);
+
+  /** @brief Set the priority of the thread sending the frames
+   *
+   *  Raising the priority prevents the thread from being preempted in the
+   *  middle of a transfer if the CPU is busy, which could cause ZeDMD to time
+   *  out. If a priority isn't permitted, the next lower one is used. A
+   *  realtime priority usually requires special permissions.
+   *  The setting could be changed at any time.
+   *
+   *  @param priority the priority
+   */
+  void SetThreadPriority(ZEDMD_THREAD_PRIORITY priority);
+
+  /** @brief Pin the thread sending the frames to some CPUs
+   *
+   *  Not supported on Apple platforms.
+   *
+   *  @param cpuMask one bit per CPU the thread may run on, 0 to leave the
+   *  affinity unchanged
+   */
+  void SetThreadAffinity(uint32_t cpuMask);
+
+  /** @brief Set the name of the thread sending the frames
+   *
+   *  The name shows up in debuggers and profilers. The default is "ZeDMD".
+   *
+   *  @param name the name, truncated to 15 characters
+   */
+  void SetThreadName(const char* name);
+
   /** @brief Clear the screen
    *
    *  Turn off all pixels of ZeDMD, so a blank black screen will be shown.
@@ -295,16 +547,221 @@ class ZEDMDAPI ZeDMD
    */
   void RenderRgb565(uint16_t* frame);
 
+  /** @brief Render a frame in one of the supported pixel formats
+   *
+   *  Renders a frame without converting it to RGB888 or RGB565 first, for
+   *  example the BGRA surface of an emulator. The rows of the frame could
+   *  be padded, the pitch is the distance between two rows in bytes.
+   *  @see ZEDMD_FRAME_FORMAT
+   *
+   *  @param frame the frame
+   *  @param format the pixel format of the frame
+   *  @param pitch the bytes per row, 0 for rows without padding
+   */
+  void RenderFrame(const uint8_t* frame, ZEDMD_FRAME_FORMAT format, uint32_t pitch = 0);
+
+  /** @brief Render a RGB24 frame asynchronously
+   *
+   *  @see RenderRgb888()
+   *  @see RenderFrameAsync()
+   *
+   *  @param frame the RGB frame
+   *  @return the ticket of the frame, 0 if ZeDMD isn't connected or the frame
+   *  was dropped by the submission policy
+   */
+  uint32_t RenderRgb888Async(uint8_t* frame);
+
+  /** @brief Render a RGB565 frame asynchronously
+   *
+   *  @see RenderRgb565()
+   *  @see RenderFrameAsync()
+   *
+   *  @param frame the RGB565 frame
+   *  @return the ticket of the frame, 0 if ZeDMD isn't connected or the frame
+   *  was dropped by the submission policy
+   */
+  uint32_t RenderRgb565Async(uint16_t* frame);
+
+  /** @brief Render a frame asynchronously
+   *
+   *  Renders a frame like RenderFrame() does and returns a ticket to track
+   *  it. Once the frame is acknowledged by ZeDMD, superseded by a newer
+   *  frame or failed, the frame callback is called with that ticket.
+   *  @see SetFrameCallback()
+   *
+   *  @param frame the frame
+   *  @param format the pixel format of the frame
+   *  @param pitch the bytes per row, 0 if the rows aren't padded
+   *  @return the ticket of the frame, 0 if ZeDMD isn't connected or the frame
+   *  was dropped by the submission policy
+   */
+  uint32_t RenderFrameAsync(const uint8_t* frame, ZEDMD_FRAME_FORMAT format, uint32_t pitch = 0);
+
+  /** @brief Render a RGB24 frame unless ZeDMD is behind
+   *
+   *  @see TryRenderFrame()
+   *
+   *  @param frame the RGB frame
+   *  @return true if the frame was rendered
+   */
+  bool TryRenderRgb888(uint8_t* frame);
+
+  /** @brief Render a RGB565 frame unless ZeDMD is behind
+   *
+   *  @see TryRenderFrame()
+   *
+   *  @param frame the RGB565 frame
+   *  @return true if the frame was rendered
+   */
+  bool TryRenderRgb565(uint16_t* frame);
+
+  /** @brief Render a frame unless ZeDMD is behind
+   *
+   *  Renders a frame like RenderFrame() does, but never blocks or coalesces
+   *  the frame, regardless of the submission policy. If ZeDMD is behind, the
+   *  frame is dropped and the caller could retry with a newer one.
+   *  @see SetSubmitPolicy()
+   *
+   *  @param frame the frame
+   *  @param format the pixel format of the frame
+   *  @param pitch the bytes per row, 0 if the rows aren't padded
+   *  @return true if the frame was rendered
+   */
+  bool TryRenderFrame(const uint8_t* frame, ZEDMD_FRAME_FORMAT format, uint32_t pitch = 0);
+
+  /** @brief Render a part of a RGB565 frame
+   *
+   *  Replaces a rectangle of the last rendered frame, for example a score
+   *  overlay. Only the rectangle is scaled and converted, including the
+   *  neighboring pixels the scaler looks at. Only the zones of ZeDMD which
+   *  intersect the rectangle are looked at, the rest of the frame isn't
+   *  compared again.
+   *  @see RenderRgb565()
+   *
+   *  @param x the left column of the rectangle within the frame
+   *  @param y the top row of the rectangle within the frame
+   *  @param width the width of the rectangle
+   *  @param height the height of the rectangle
+   *  @param frame the RGB565 pixels of the rectangle
+   *  @param pitch the bytes per row, 0 for rows without padding
+   */
+  void RenderRgb565Region(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint16_t* frame,
+                          uint32_t pitch = 0);
+
+  /** @brief Render a part of a RGB24 frame
+   *
+   *  Replaces a rectangle of the last rendered frame, like
+   *  RenderRgb565Region() does.
+   *  @see RenderRgb888()
+   *
+   *  @param x the left column of the rectangle within the frame
+   *  @param y the top row of the rectangle within the frame
+   *  @param width the width of the rectangle
+   *  @param height the height of the rectangle
+   *  @param frame the RGB pixels of the rectangle
+   *  @param pitch the bytes per row, 0 for rows without padding
+   */
+  void RenderRgb888Region(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint8_t* frame,
+                          uint32_t pitch = 0);
+
+  /** @brief Set the palette for indexed frames
+   *
+   *  Sets the colors used by RenderGray2(), RenderGray4() and
+   *  RenderIndexed8(). The 4 shades of a 2 bit frame and the 16 shades of
+   *  a 4 bit frame are spread over the whole palette, so a palette of 16
+   *  colors could be used for both. Indices without a color are black.
+   *  @see SetDefaultPalette()
+   *
+   *  @param palette the colors as RGB888, 3 bytes per color
+   *  @param numColors the number of colors, up to 256
+   */
+  void SetPalette(const uint8_t* palette, uint16_t numColors);
+
+  /** @brief Set the default palette
+   *
+   *  Sets a palette of orange shades, like classic DMDs. This is the
+   *  initial palette for a bit depth of 4.
+   *  @see SetPalette()
+   *
+   *  @param bitDepth the bit depth of the palette, 1 to 8
+   */
+  void SetDefaultPalette(uint8_t bitDepth);
+
+  /** @brief Set the color correction
+   *
+   *  Corrects the colors of all rendered frames for the LEDs of the panel.
+   *  The correction is precomputed into lookup tables per channel, which
+   *  are applied while converting a frame to RGB565, so it doesn't add
+   *  another pass over the frame. Each channel becomes
+   *  255 * gain * brightness * (value / 255) ^ gamma.
+   *  A gamma of 1 and gains and brightness of 1 disable the correction.
+   *  @see SetBrightness()
+   *
+   *  @param gamma the gamma exponent, greater than 0
+   *  @param redGain the gain of the red channel, for the white balance
+   *  @param greenGain the gain of the green channel
+   *  @param blueGain the gain of the blue channel
+   *  @param brightness the scale of all channels
+   */
+  void SetColorCorrection(float gamma, float redGain, float greenGain, float blueGain, float brightness);
+
+  /** @brief Render a 2 bit frame
+   *
+   *  Renders a frame of 4 shades, one byte per pixel.
+   *  @see SetPalette()
+   *
+   *  @param frame the frame
+   */
+  void RenderGray2(uint8_t* frame);
+
+  /** @brief Render a 4 bit frame
+   *
+   *  Renders a frame of 16 shades, one byte per pixel.
+   *  @see SetPalette()
+   *
+   *  @param frame the frame
+   */
+  void RenderGray4(uint8_t* frame);
+
+  /** @brief Render an indexed frame
+   *
+   *  Renders a frame of palette indices, one byte per pixel.
+   *  @see SetPalette()
+   *
+   *  @param frame the frame
+   */
+  void RenderIndexed8(uint8_t* frame);
+
  private:
-  bool UpdateFrameBuffer888(uint8_t* pFrame);
-  bool UpdateFrameBuffer565(uint16_t* pFrame);
-  uint8_t GetScaleMode(uint16_t frameWidth, uint16_t frameHeight,
-                       uint8_t* pXOffset, uint8_t* pYOffset);
-  int Scale888(uint8_t* pScaledFrame, uint8_t* pFrame, uint8_t bytes);
-  int Scale565(uint8_t* pScaledFrame, uint16_t* pFrame, bool bigEndian);
+  bool UpdateFrameBuffer(const uint8_t* pFrame, uint32_t rowBytes, uint32_t pitch, uint8_t** ppBuffer);
+  bool AcceptFrame();
+  bool SubmitFrame(const uint8_t* pFrame, ZEDMD_FRAME_FORMAT format, uint32_t pitch, const uint16_t* pPaletteLut,
+                   uint32_t ticket);
+  void SubmitRegion(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint8_t* pData,
+                    ZEDMD_FRAME_FORMAT format, uint32_t pitch);
+  bool Submit(ZeDMDRenderJob* pJob);
+  bool Encode(ZeDMDRenderJob* pJob);
+  void WaitForPipeline();
+  void SelectPaletteLut(const uint16_t* pPaletteLut);
+  void UpdatePaletteLuts();
+  void Render(const uint8_t* pFrame, ZEDMD_FRAME_FORMAT format, uint32_t pitch, uint8_t** ppBuffer = nullptr);
+  void RenderRegion(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint8_t* pData,
+                    ZEDMD_FRAME_FORMAT format, uint32_t pitch);
+  void QueueRgb565(const uint8_t* pFrame, ZEDMD_FRAME_FORMAT format, uint16_t x, uint16_t y, uint16_t width,
+                   uint16_t height);
+  void ConvertFrameBuffer(ZEDMD_FRAME_FORMAT format);
+  void AllocateFrameBuffers(uint16_t width, uint16_t height);
+  bool UpdateScalingPlan();
+  int ScaleToRgb565(const uint8_t* pFrame, ZEDMD_FRAME_FORMAT format, uint16_t left, uint16_t top, uint16_t right,
+                    uint16_t bottom);
+  template <ZEDMD_FRAME_FORMAT format>
+  void GatherRgb565(const uint8_t* pSource, uint16_t sourceWidth, uint16_t left, uint16_t top, uint16_t right,
+                    uint16_t bottom);
 
   ZeDMDComm* m_pZeDMDComm;
   ZeDMDWiFi* m_pZeDMDWiFi;
+  ZeDMDPipeline* m_pPipeline = nullptr;
+  ZEDMD_SUBMIT_POLICY m_submitPolicy = ZEDMD_POLICY_LATEST_WINS;
 
   uint16_t m_romWidth;
   uint16_t m_romHeight;
@@ -314,9 +771,50 @@ class ZEDMDAPI ZeDMD
   bool m_hd = false;
   bool m_upscaling = false;
 
+  // Precomputed mapping of a ROM frame onto the ZeDMD panel, see UpdateScalingPlan().
+  struct ScalingPlan
+  {
+    uint16_t romWidth = 0;
+    uint16_t romHeight = 0;
+    uint16_t frameWidth = 0;
+    uint16_t frameHeight = 0;
+    bool upscaling = false;
+    // 0: gather by index tables, 1: scale down by factor 2, 2: scale up by factor 2
+    uint8_t mode = 0;
+    uint16_t width = 0;
+    uint16_t height = 0;
+    uint16_t xOffset = 0;
+    uint16_t yOffset = 0;
+    // The ROM frame matches the panel, so it doesn't need to be scaled at all.
+    bool passthrough = false;
+    uint16_t xSource[ZEDMD_MAX_WIDTH];
+    uint16_t ySource[ZEDMD_MAX_HEIGHT];
+  };
+  ScalingPlan m_scalingPlan;
+
+  uint8_t m_palette[256 * 3];
+  uint16_t m_numColors = 0;
+  // RGB565 colors of the palette and of the shades of 2 and 4 bit frames, indexed by the pixel value.
+  uint16_t m_paletteLut[256];
+  uint16_t m_gray2Lut[256];
+  uint16_t m_gray4Lut[256];
+  const uint16_t* m_pPaletteLut = m_paletteLut;
+  bool m_paletteChanged = false;
+
+  // RGB565 bits of the corrected red, green and blue channels, nullptr without a color correction.
+  uint16_t m_colorLut[3 * 256];
+  const uint16_t* m_pColorLut = nullptr;
+  bool m_colorChanged = false;
+
+  // The last frame in the format it was rendered in.
   uint8_t* m_pFrameBuffer;
+  ZEDMD_FRAME_FORMAT m_frameFormat = ZEDMD_FORMAT_RGB888;
   uint8_t* m_pScaledFrameBuffer;
+  // The last ticket returned by one of the Async functions.
+  uint32_t m_ticket = 0;
   uint8_t* m_pRgb565Buffer;
+  // The RGB565 buffer holds the conversion of the retained frame, so a region only needs to convert its own pixels.
+  bool m_rgb565Valid = false;
 };
 
 #ifdef __cplusplus
@@ -332,8 +830,20 @@ extern "C"
   extern ZEDMDAPI bool ZeDMD_OpenWiFi(ZeDMD* pZeDMD, const char* ip, int port);
   extern ZEDMDAPI bool ZeDMD_OpenDefaultWiFi(ZeDMD* pZeDMD);
   extern ZEDMDAPI void ZeDMD_Close(ZeDMD* pZeDMD);
-
+  extern ZEDMDAPI uint32_t ZeDMD_GetChunkCacheHits(ZeDMD* pZeDMD);
+  extern ZEDMDAPI uint32_t ZeDMD_GetChunkCacheMisses(ZeDMD* pZeDMD);
+  extern ZEDMDAPI float ZeDMD_GetFps(ZeDMD* pZeDMD);
+  extern ZEDMDAPI uint32_t ZeDMD_GetLatency(ZeDMD* pZeDMD);
+  extern ZEDMDAPI uint8_t ZeDMD_GetQueueDepth(ZeDMD* pZeDMD);
+  extern ZEDMDAPI void ZeDMD_SetSubmitPolicy(ZeDMD* pZeDMD, ZEDMD_SUBMIT_POLICY policy);
+  extern ZEDMDAPI void ZeDMD_SetThreadPriority(ZeDMD* pZeDMD, ZEDMD_THREAD_PRIORITY priority);
+  extern ZEDMDAPI void ZeDMD_SetThreadAffinity(ZeDMD* pZeDMD, uint32_t cpuMask);
+  extern ZEDMDAPI void ZeDMD_SetThreadName(ZeDMD* pZeDMD, const char* name);
+
+  extern ZEDMDAPI void ZeDMD_SetColorCorrection(ZeDMD* pZeDMD, float gamma, float redGain, float greenGain,
+                                                float blueGain, float brightness);
   extern ZEDMDAPI void ZeDMD_SetFrameSize(ZeDMD* pZeDMD, uint16_t width, uint16_t height);
+  extern ZEDMDAPI void ZeDMD_SetPalette(ZeDMD* pZeDMD, const uint8_t* palette, uint16_t numColors);
   extern ZEDMDAPI void ZeDMD_SetDefaultPalette(ZeDMD* pZeDMD, uint8_t bitDepth);
   extern ZEDMDAPI void ZeDMD_LedTest(ZeDMD* pZeDMD);
   extern ZEDMDAPI void ZeDMD_EnableDebug(ZeDMD* pZeDMD);
@@ -343,6 +853,13 @@ extern "C"
   extern ZEDMDAPI void ZeDMD_SaveSettings(ZeDMD* pZeDMD);
   extern ZEDMDAPI void ZeDMD_EnableUpscaling(ZeDMD* pZeDMD);
   extern ZEDMDAPI void ZeDMD_DisableUpscaling(ZeDMD* pZeDMD);
+  extern ZEDMDAPI void ZeDMD_EnableStreamingCompression(ZeDMD* pZeDMD);
+  extern ZEDMDAPI void ZeDMD_DisableStreamingCompression(ZeDMD* pZeDMD);
+  extern ZEDMDAPI void ZeDMD_EnableRenderPipeline(ZeDMD* pZeDMD);
+  extern ZEDMDAPI void ZeDMD_DisableRenderPipeline(ZeDMD* pZeDMD);
+  extern ZEDMDAPI uint8_t* ZeDMD_AcquireBackBuffer(ZeDMD* pZeDMD);
+  extern ZEDMDAPI uint32_t ZeDMD_PublishBackBuffer(ZeDMD* pZeDMD, ZEDMD_FRAME_FORMAT format);
+  extern ZEDMDAPI void ZeDMD_SetFramePacing(ZeDMD* pZeDMD, uint8_t fps, uint16_t latencyBudget);
   extern ZEDMDAPI void ZeDMD_SetWiFiSSID(ZeDMD* pZeDMD, const char* const ssid);
   extern ZEDMDAPI void ZeDMD_SetWiFiPassword(ZeDMD* pZeDMD, const char* const password);
   extern ZEDMDAPI void ZeDMD_SetWiFiPort(ZeDMD* pZeDMD, int port);
@@ -350,6 +867,24 @@ extern "C"
   extern ZEDMDAPI void ZeDMD_ClearScreen(ZeDMD* pZeDMD);
   extern ZEDMDAPI void ZeDMD_RenderRgb888(ZeDMD* pZeDMD, uint8_t* frame);
   extern ZEDMDAPI void ZeDMD_RenderRgb565(ZeDMD* pZeDMD, uint16_t* frame);
+  extern ZEDMDAPI void ZeDMD_RenderRgb565Region(ZeDMD* pZeDMD, uint16_t x, uint16_t y, uint16_t width,
+                                                uint16_t height, const uint16_t* frame, uint32_t pitch);
+  extern ZEDMDAPI void ZeDMD_RenderRgb888Region(ZeDMD* pZeDMD, uint16_t x, uint16_t y, uint16_t width,
+                                                uint16_t height, const uint8_t* frame, uint32_t pitch);
+  extern ZEDMDAPI void ZeDMD_RenderGray2(ZeDMD* pZeDMD, uint8_t* frame);
+  extern ZEDMDAPI void ZeDMD_RenderGray4(ZeDMD* pZeDMD, uint8_t* frame);
+  extern ZEDMDAPI void ZeDMD_RenderIndexed8(ZeDMD* pZeDMD, uint8_t* frame);
+  extern ZEDMDAPI void ZeDMD_RenderFrame(ZeDMD* pZeDMD, const uint8_t* frame, ZEDMD_FRAME_FORMAT format,
+                                         uint32_t pitch);
+  extern ZEDMDAPI void ZeDMD_SetFrameCallback(ZeDMD* pZeDMD, ZeDMD_FrameCallback callback, const void* userData);
+  extern ZEDMDAPI uint32_t ZeDMD_RenderRgb888Async(ZeDMD* pZeDMD, uint8_t* frame);
+  extern ZEDMDAPI uint32_t ZeDMD_RenderRgb565Async(ZeDMD* pZeDMD, uint16_t* frame);
+  extern ZEDMDAPI uint32_t ZeDMD_RenderFrameAsync(ZeDMD* pZeDMD, const uint8_t* frame, ZEDMD_FRAME_FORMAT format,
+                                                  uint32_t pitch);
+  extern ZEDMDAPI bool ZeDMD_TryRenderRgb888(ZeDMD* pZeDMD, uint8_t* frame);
+  extern ZEDMDAPI bool ZeDMD_TryRenderRgb565(ZeDMD* pZeDMD, uint16_t* frame);
+  extern ZEDMDAPI bool ZeDMD_TryRenderFrame(ZeDMD* pZeDMD, const uint8_t* frame, ZEDMD_FRAME_FORMAT format,
+                                            uint32_t pitch);
 
 #ifdef __cplusplus
 }
@@ -1,5 +1,19 @@
 #include "ZeDMDComm.h"
 
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
 #include "komihash/komihash.h"
 #include "miniz/miniz.h"
 
@@ -7,8 +21,19 @@ ZeDMDComm::ZeDMDComm()
 {
   m_stopFlag.store(false, std::memory_order_release);
   m_fullFrameFlag.store(false, std::memory_order_release);
+  m_resyncFlag.store(false, std::memory_order_release);
+  m_deviceCapabilities.store(0, std::memory_order_release);
+  m_streamingCompression.store(false, std::memory_order_release);
+  m_chunkCacheHits.store(0, std::memory_order_release);
+  m_chunkCacheMisses.store(0, std::memory_order_release);
+  m_frameInterval.store(0, std::memory_order_release);
+  m_latencyBudget.store(0, std::memory_order_release);
+  m_fps.store(0.0f, std::memory_order_release);
+  m_latency.store(0, std::memory_order_release);
+  m_threadSettingsChanged.store(true, std::memory_order_release);
 
   m_pThread = nullptr;
+  m_pHashZones = &ZeDMDComm::HashZones<0, 0>;
 #if !(                                                                                                                \
     (defined(__APPLE__) && ((defined(TARGET_OS_IOS) && TARGET_OS_IOS) || (defined(TARGET_OS_TV) && TARGET_OS_TV))) || \
     defined(__ANDROID__))
@@ -37,6 +62,12 @@ void ZeDMDComm::SetLogCallback(ZeDMD_LogCallback callback, const void* userData)
   m_logUserData = userData;
 }
 
+void ZeDMDComm::SetFrameCallback(ZeDMD_FrameCallback callback, const void* userData)
+{
+  m_frameCallback = callback;
+  m_frameUserData = userData;
+}
+
 void ZeDMDComm::Log(const char* format, ...)
 {
   if (!m_logCallback)
@@ -50,6 +81,35 @@ void ZeDMDComm::Log(const char* format, ...)
   va_end(args);
 }
 
+void ZeDMDComm::AllocateFrameQueue()
+{
+  // A chunk is queued once it exceeds the byte limit minus one zone, so a frame never needs more chunks than this.
+  const int zoneBytesTotal = m_zoneWidth * m_zoneHeight * 2 + 2;
+  const int chunks = 128 * zoneBytesTotal / (ZEDMD_ZONES_BYTE_LIMIT - zoneBytesTotal + 1) + 1;
+  // The frames of a region or a shift might be queued while the queue just got full.
+  const int frames = ZEDMD_COMM_FRAME_QUEUE_SIZE_MAX + 2;
+  // Tickets of unchanged frames are added to the pending frame, a few of them fit without allocating.
+  const int numTickets = ZEDMD_COMM_FRAME_QUEUE_SIZE_MAX;
+
+  // The frames built by QueueFrame(), QueueDirtyZones() and the streamed one hold chunks, too.
+  m_chunkPool.Allocate((frames + 3) * chunks);
+
+  m_frameQueueMutex.lock();
+  m_frames.Allocate(frames, chunks, numTickets);
+  m_queuedFrame.Reserve(chunks, numTickets);
+  m_shiftFrame.Reserve(1, numTickets);
+  m_streamedFrame.Reserve(chunks, numTickets);
+  m_dirtyFrame.Reserve(chunks, numTickets);
+  m_streamingTickets.reserve(numTickets);
+  m_completedTickets.reserve(numTickets);
+  m_frameQueueMutex.unlock();
+
+  m_dirtyZonesMutex.lock();
+  m_dirtyTickets.reserve(numTickets);
+  m_supersededTickets.reserve(numTickets);
+  m_dirtyZonesMutex.unlock();
+}
+
 void ZeDMDComm::Run()
 {
   m_pThread = new std::thread(
@@ -57,50 +117,79 @@ void ZeDMDComm::Run()
       {
         Log("ZeDMDComm run thread starting");
         m_stopFlag.load(std::memory_order_acquire);
+        m_statsStart = std::chrono::steady_clock::now();
+        bool afterShift = false;
 
         while (IsConnected() && !m_stopFlag.load(std::memory_order_relaxed))
         {
+          if (m_threadSettingsChanged.exchange(false, std::memory_order_acq_rel)) ApplyThreadSettings();
+
+          StreamCommands();
+
           m_frameQueueMutex.lock();
 
-          if (m_frames.empty())
+          if (m_frames.Empty())
           {
-            m_delayedFrameMutex.lock();
-            // All frames are sent, move delayed frame into the frames queue.
-            if (m_delayedFrameReady)
+            // All frames are sent, queue the zones that changed while ZeDMD was behind.
+            if (QueueDirtyZones())
             {
-              m_frames.push(std::move(m_delayedFrame));
-              m_delayedFrameReady = false;
-              m_delayedFrameMutex.unlock();
               m_frameQueueMutex.unlock();
+              m_frameQueueCondition.notify_all();
 
               continue;
             }
-            m_delayedFrameMutex.unlock();
             m_frameQueueMutex.unlock();
+            UpdateFps();
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
 
             continue;
           }
 
-          if (m_frames.front().data.empty())
+          // Stream the frame without holding the queue, so new frames could be queued or coalesced meanwhile.
+          ZeDMDFrame& frame = m_streamedFrame;
+          m_frames.Pop(frame);
+          m_streamingFrame = true;
+          m_streamingTickets.swap(frame.tickets);
+          m_frameQueueMutex.unlock();
+          m_frameQueueCondition.notify_all();
+
+          if (frame.data.empty())
           {
             // In case of a simple command, add metadata to indicate that the payload data size is 0.
-            m_frames.front().data.emplace_back(nullptr, 0);
+            frame.data.emplace_back(nullptr, 0);
           }
-          bool success = StreamBytes(&(m_frames.front()));
-          m_frames.pop();
+          bool zonesStream = IsZonesStream(frame.command) || ZEDMD_COMM_COMMAND::ShiftRegions == frame.command;
+          // A shift and the zones based on it are one frame.
+          if (zonesStream && !afterShift) PaceFrame();
+          afterShift = (ZEDMD_COMM_COMMAND::ShiftRegions == frame.command);
+
+          bool success = StreamBytes(&frame);
+          if (success && IsZonesStream(frame.command)) UpdateFrameStats(frame.submitted);
+          // Give the chunks back to the pool.
+          frame.data.clear();
 
+          // Tickets of unchanged frames might have been added while streaming.
+          m_frameQueueMutex.lock();
+          m_completedTickets.swap(m_streamingTickets);
+          m_streamingFrame = false;
           m_frameQueueMutex.unlock();
+          CompleteTickets(m_completedTickets, success ? ZEDMD_STATUS_ACKNOWLEDGED : ZEDMD_STATUS_FAILED);
+          m_completedTickets.clear();
 
           if (!success)
           {
             Log("ZeDMD StreamBytes failed");
 
+            // Some zones might not have reached ZeDMD, so the next frame needs to be complete.
+            if (zonesStream) m_resyncFlag.store(true, std::memory_order_release);
+
             // Allow ZeDMD to empty its buffers.
             std::this_thread::sleep_for(std::chrono::milliseconds(2));
           }
         }
 
+        FailQueuedFrames();
+
         Log("ZeDMDComm run thread finished");
       });
 }
@@ -112,153 +201,992 @@ void ZeDMDComm::QueueCommand(char command, uint8_t* data, int size)
     return;
   }
 
-  // "Delete" delayed frame.
-  m_delayedFrameMutex.lock();
-  m_delayedFrameReady = false;
-  m_delayedFrameMutex.unlock();
-
   ZeDMDFrame frame(command, data, size);
 
+  if (!IsRepaintCommand(command))
+  {
+    // Settings don't change the content of ZeDMD, so they overtake the queued frames and keep the zones as they are.
+    m_commandQueueMutex.lock();
+    m_commands.push(std::move(frame));
+    m_commandQueueMutex.unlock();
+
+    return;
+  }
+
+  // The next streaming is complete anyway.
+  DiscardDirtyZones();
+
   m_frameQueueMutex.lock();
-  m_frames.push(std::move(frame));
+  m_frames.Push(frame);
   m_frameQueueMutex.unlock();
 
   // Next streaming needs to be complete, except black zones.
-  memset(m_zoneHashes, ZEDMD_COMM_COMMAND::ClearScreen == command ? 1 : 0, sizeof(m_zoneHashes));
+  ResetZones(ZEDMD_COMM_COMMAND::ClearScreen == command ? 1 : 0);
+}
+
+void ZeDMDComm::BeginTicket(uint32_t ticket) { m_ticket = ticket; }
+
+void ZeDMDComm::EndTicket()
+{
+  if (0 == m_ticket) return;
+
+  const uint32_t ticket = m_ticket;
+  m_ticket = 0;
+
+  // No frame was queued for the ticket, so it is displayed along with the newest content that is pending.
+  bool pending = true;
+  m_frameQueueMutex.lock();
+  m_dirtyZonesMutex.lock();
+  if (m_numDirtyZones > 0) m_dirtyTickets.push_back(ticket);
+  else if (!m_frames.Empty()) m_frames.Back().tickets.push_back(ticket);
+  else if (m_streamingFrame) m_streamingTickets.push_back(ticket);
+  else pending = false;
+  m_dirtyZonesMutex.unlock();
+  m_frameQueueMutex.unlock();
+
+  if (!pending) CompleteTicket(ticket, ZEDMD_STATUS_ACKNOWLEDGED);
+}
+
+void ZeDMDComm::SupersedeTicket(uint32_t ticket) { CompleteTicket(ticket, ZEDMD_STATUS_SUPERSEDED); }
+
+void ZeDMDComm::CompleteTickets(const std::vector<uint32_t>& tickets, ZEDMD_FRAME_STATUS status)
+{
+  for (uint32_t ticket : tickets)
+  {
+    CompleteTicket(ticket, status);
+  }
+}
+
+void ZeDMDComm::CompleteTicket(uint32_t ticket, ZEDMD_FRAME_STATUS status)
+{
+  if (m_frameCallback) (*(m_frameCallback))(ticket, status, m_frameUserData);
+}
+
+void ZeDMDComm::FailQueuedFrames()
+{
+  std::vector<uint32_t> tickets;
+
+  m_frameQueueMutex.lock();
+  while (!m_frames.Empty())
+  {
+    tickets.insert(tickets.end(), m_frames.Front().tickets.begin(), m_frames.Front().tickets.end());
+    m_frames.Pop();
+  }
+  m_dirtyZonesMutex.lock();
+  tickets.insert(tickets.end(), m_dirtyTickets.begin(), m_dirtyTickets.end());
+  m_dirtyTickets.clear();
+  m_dirtyZonesMutex.unlock();
+  m_frameQueueMutex.unlock();
+  m_frameQueueCondition.notify_all();
+
+  CompleteTickets(tickets, ZEDMD_STATUS_FAILED);
+}
+
+void ZeDMDComm::PaceFrame()
+{
+  const uint32_t interval = m_frameInterval.load(std::memory_order_relaxed);
+  if (0 == interval) return;
+
+  // Commands are still sent while waiting for the slot of the next frame.
+  const auto slot = m_lastFrameSlot + std::chrono::microseconds(interval);
+  auto now = std::chrono::steady_clock::now();
+  while (now < slot && !m_stopFlag.load(std::memory_order_relaxed))
+  {
+    StreamCommands();
+    std::this_thread::sleep_until(std::min(slot, now + std::chrono::milliseconds(1)));
+    now = std::chrono::steady_clock::now();
+  }
+
+  m_lastFrameSlot = now;
+}
+
+void ZeDMDComm::UpdateFrameStats(std::chrono::steady_clock::time_point submitted)
+{
+  const uint32_t latency =
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - submitted).count();
+  // Smooth the latency over the last frames.
+  const uint32_t previous = m_latency.load(std::memory_order_relaxed);
+  m_latency.store((0 == previous) ? latency : (uint32_t)(((uint64_t)previous * 7 + latency) / 8),
+                  std::memory_order_relaxed);
+
+  m_statsFrames++;
+  UpdateFps();
+}
+
+void ZeDMDComm::UpdateFps()
+{
+  const auto now = std::chrono::steady_clock::now();
+  const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - m_statsStart).count();
+  if (elapsed < 1000000) return;
+
+  m_fps.store(m_statsFrames * 1000000.0f / elapsed, std::memory_order_relaxed);
+  m_statsFrames = 0;
+  m_statsStart = now;
+}
+
+void ZeDMDComm::StreamCommands()
+{
+  while (true)
+  {
+    m_commandQueueMutex.lock();
+    if (m_commands.empty())
+    {
+      m_commandQueueMutex.unlock();
+      return;
+    }
+    ZeDMDFrame command = std::move(m_commands.front());
+    m_commands.pop();
+    m_commandQueueMutex.unlock();
+
+    if (!StreamBytes(&command))
+    {
+      Log("ZeDMD StreamBytes failed for command 0x%02x", command.command);
+    }
+  }
 }
 
 void ZeDMDComm::QueueCommand(char command, uint8_t value) { QueueCommand(command, &value, 1); }
 
 void ZeDMDComm::QueueCommand(char command) { QueueCommand(command, nullptr, 0); }
 
-void ZeDMDComm::QueueFrame(uint8_t* data, int size)
+void ZeDMDComm::QueueFrame(uint8_t* data, int size) { QueueFrame(data, size, 0, 0, m_width, m_height); }
+
+void ZeDMDComm::QueueFrame(uint8_t* data, int size, uint16_t x, uint16_t y, uint16_t width, uint16_t height)
 {
-  if (0 == memcmp(data, m_allBlack, size) || m_fullFrameFlag.load(std::memory_order_relaxed))
+  if (x >= m_width || y >= m_height) return;
+  width = std::min<uint16_t>(width, m_width - x);
+  height = std::min<uint16_t>(height, m_height - y);
+
+  // The run thread lost zones or reconnected to ZeDMD. The zones belong to this thread, so they are reset here.
+  if (m_resyncFlag.exchange(false, std::memory_order_acq_rel))
+  {
+    // The dirty zones are encoded by the run thread, so the capabilities only change while they are locked.
+    m_dirtyZonesMutex.lock();
+    m_capabilities = m_deviceCapabilities.load(std::memory_order_acquire);
+    m_dirtyZonesMutex.unlock();
+    SelectZonePipeline();
+    ResetZones(0);
+  }
+
+  // Only the zones intersecting the region need to be looked at, unless the hashes don't reflect ZeDMD anymore.
+  bool full = !m_zoneHashesValid || (0 == x && 0 == y && m_width == width && m_height == height);
+
+  if ((full && 0 == memcmp(data, m_allBlack, size)) || m_fullFrameFlag.load(std::memory_order_relaxed))
   {
     m_fullFrameFlag.store(false, std::memory_order_release);
 
-    // Queue a clear screen command. Don't call QueueCommand(ZEDMD_COMM_COMMAND::ClearScreen) because we need to set
-    // black hashes.
-    ZeDMDFrame frame(ZEDMD_COMM_COMMAND::ClearScreen);
+    // Queue a clear screen command. Don't call QueueCommand(ZEDMD_COMM_COMMAND::ClearScreen) because we need to set
+    // black hashes.
+    ZeDMDFrame& frame = m_queuedFrame;
+    frame.Reset(ZEDMD_COMM_COMMAND::ClearScreen);
+    if (m_ticket) frame.tickets.push_back(m_ticket);
+    m_ticket = 0;
+
+    // If ZeDMD is already behind, clear the screen immediately.
+    if (IsBehind())
+    {
+      m_frameQueueMutex.lock();
+      while (!m_frames.Empty())
+      {
+        m_supersededTickets.insert(m_supersededTickets.end(), m_frames.Front().tickets.begin(),
+                                   m_frames.Front().tickets.end());
+        m_frames.Pop();
+      }
+      m_frameQueueMutex.unlock();
+      CompleteTickets(m_supersededTickets, ZEDMD_STATUS_SUPERSEDED);
+      m_supersededTickets.clear();
+
+      DiscardDirtyZones();
+    }
+
+    m_frameQueueMutex.lock();
+    m_frames.Push(frame);
+    m_frameQueueMutex.unlock();
+
+    // Use "1" as hash for black.
+    ResetZones(1);
+
+    return;
+  }
+
+  uint8_t idx = 0;
+  uint16_t zonesBytesLimit = ZEDMD_ZONES_BYTE_LIMIT;
+  const bool encoded = (m_capabilities & (ZEDMD_COMM_CAPABILITY::XorDeltaZones | ZEDMD_COMM_CAPABILITY::IndexedZones |
+                                          ZEDMD_COMM_CAPABILITY::SolidZones));
+  const bool shiftRegions = (m_capabilities & ZEDMD_COMM_CAPABILITY::RegionShifts);
+  const uint16_t zoneBytes = m_zoneWidth * m_zoneHeight * 2;
+  // The encoded stream adds the encoding byte to each zone.
+  const uint16_t zoneBytesTotal = zoneBytes + (encoded ? 2 : 1);
+  // Persistent scratch buffers, QueueFrame() is called for every frame.
+  uint8_t* zone = m_zoneScratch;
+  uint8_t* buffer = m_zonesScratch;
+  uint16_t bufferPosition = 0;
+  const uint16_t bufferSizeThreshold = zonesBytesLimit - zoneBytesTotal;
+
+  ZeDMDFrame& frame = m_queuedFrame;
+  frame.Reset(encoded ? ZEDMD_COMM_COMMAND::RGB565EncodedZonesStream : ZEDMD_COMM_COMMAND::RGB565ZonesStream);
+
+  // While ZeDMD is behind, the changed zones are only marked dirty. The run thread sends the latest content of the
+  // dirty zones once the queue is drained, so a slow connection results in a lower frame rate instead of full frames.
+  const bool behind = IsBehind();
+  if (behind) Log("ZeDMD is behind, changed zones will be coalesced");
+
+  // Deltas could only be applied if ZeDMD is known to display the retained zone contents.
+  const bool deltaAllowed = (m_capabilities & ZEDMD_COMM_CAPABILITY::XorDeltaZones) && m_zoneContentsValid;
+
+  // Let ZeDMD shift scrolling content first, the zones below only need to cover what the shift doesn't.
+  ZeDMDFrame& shiftFrame = m_shiftFrame;
+  shiftFrame.Reset(ZEDMD_COMM_COMMAND::ShiftRegions);
+  bool shifted = false;
+  if (full && shiftRegions && m_zoneContentsValid && !behind)
+  {
+    uint8_t regions[1 + 8 * 10];
+    uint16_t regionsSize = DetectShifts(data, regions);
+    if (regionsSize > 0)
+    {
+      shiftFrame.data.emplace_back(&m_chunkPool, regions, regionsSize);
+      shifted = true;
+    }
+  }
+
+  // Hash the zones using the pipeline selected for the panel geometry, only changed zones are extracted again below.
+  if (full)
+  {
+    (this->*m_pHashZones)(data, 0, 0, 16, 8);
+    m_zoneHashesValid = true;
+  }
+  else
+  {
+    memcpy(m_frameZoneHashes, m_zoneHashes, sizeof(m_frameZoneHashes));
+    (this->*m_pHashZones)(data, x / m_zoneWidth, y / m_zoneHeight, (x + width + m_zoneWidth - 1) / m_zoneWidth,
+                          (y + height + m_zoneHeight - 1) / m_zoneHeight);
+  }
+
+  memset(buffer, 0, zonesBytesLimit);
+  bool dirtied = false;
+  if (behind) m_dirtyZonesMutex.lock();
+  for (uint16_t y = 0; y < m_height; y += m_zoneHeight)
+  {
+    for (uint16_t x = 0; x < m_width; x += m_zoneWidth)
+    {
+      uint64_t hash = m_frameZoneHashes[idx];
+      if (hash != m_zoneHashes[idx])
+      {
+        m_zoneHashes[idx] = hash;
+        bool solid = ExtractZone(data, x, y, zone);
+
+        if (behind)
+        {
+          ZeDMDDirtyZone& dirtyZone = m_dirtyZones[idx];
+          if (!dirtyZone.dirty) m_numDirtyZones++;
+          dirtyZone.dirty = true;
+          dirtyZone.solid = solid;
+          memcpy(dirtyZone.data, zone, zoneBytes);
+          m_dirtySubmitted = frame.submitted;
+          dirtied = true;
+        }
+        else
+        {
+          bufferPosition += AppendZone(&buffer[bufferPosition], idx, zone, solid, deltaAllowed);
+          if (bufferPosition > bufferSizeThreshold)
+          {
+            frame.data.emplace_back(&m_chunkPool, buffer, bufferPosition);
+            memset(buffer, 0, zonesBytesLimit);
+            bufferPosition = 0;
+          }
+        }
+
+        if (encoded)
+        {
+          // Retain the transmitted content as reference for the next delta. Dirty zones are sent without a delta, so
+          // they become the reference, too.
+          memcpy(m_zoneContents[idx], zone, zoneBytes);
+        }
+      }
+
+      idx++;
+    }
+  }
+  // The pending dirty zones don't show the frames of their tickets anymore.
+  if (dirtied)
+  {
+    m_supersededTickets.swap(m_dirtyTickets);
+    if (m_ticket) m_dirtyTickets.push_back(m_ticket);
+    m_ticket = 0;
+  }
+  if (behind) m_dirtyZonesMutex.unlock();
+  CompleteTickets(m_supersededTickets, ZEDMD_STATUS_SUPERSEDED);
+  m_supersededTickets.clear();
+
+  if (bufferPosition > 0)
+  {
+    frame.data.emplace_back(&m_chunkPool, buffer, bufferPosition);
+  }
+
+  // All zones are either retained now or known to be unchanged.
+  m_zoneContentsValid = encoded || shiftRegions;
+  if (shiftRegions)
+  {
+    // All zones were looked at if the frame was forced to be full, so the mirror needs to cover all of them, too.
+    if (full) memcpy(m_previousFrame, data, m_width * m_height * 2);
+    else memcpy(&m_previousFrame[y * m_width * 2], &data[y * m_width * 2], m_width * height * 2);
+  }
+
+  if (!behind)
+  {
+    m_frameQueueMutex.lock();
+    // The zones are based on the shifted content, so both need to be queued together.
+    if (shifted) m_frames.Push(shiftFrame);
+    if (m_ticket) frame.tickets.push_back(m_ticket);
+    m_ticket = 0;
+    m_frames.Push(frame);
+    m_frameQueueMutex.unlock();
+  }
+  else
+  {
+    // Nothing is queued, the chunks of the regions go back to the pool.
+    shiftFrame.data.clear();
+  }
+}
+
+uint16_t ZeDMDComm::AppendZone(uint8_t* pBuffer, uint8_t idx, const uint8_t* pZone, bool solid, bool deltaAllowed)
+{
+  const bool encoded = (m_capabilities & (ZEDMD_COMM_CAPABILITY::XorDeltaZones | ZEDMD_COMM_CAPABILITY::IndexedZones |
+                                          ZEDMD_COMM_CAPABILITY::SolidZones));
+  const bool indexed = (m_capabilities & ZEDMD_COMM_CAPABILITY::IndexedZones);
+  const bool solidZones = (m_capabilities & ZEDMD_COMM_CAPABILITY::SolidZones);
+  const uint16_t zoneBytes = m_zoneWidth * m_zoneHeight * 2;
+  const uint16_t zonePixels = m_zoneWidth * m_zoneHeight;
+  uint16_t position = 0;
+
+  if (solid && 0 == pZone[0] && 0 == pZone[1])
+  {
+    // In case of a full black zone, just send the zone index ID and add 128.
+    pBuffer[position++] = idx + 128;
+  }
+  else if (solid && solidZones)
+  {
+    pBuffer[position++] = idx;
+    pBuffer[position++] = ZEDMD_ZONE_ENCODING::ZoneSolid;
+    pBuffer[position++] = pZone[0];
+    pBuffer[position++] = pZone[1];
+  }
+  else if (encoded)
+  {
+    pBuffer[position++] = idx;
+    uint16_t changedPixels =
+        deltaAllowed ? EncodeXorDelta(&pBuffer[position + 1], pZone, m_zoneContents[idx], zoneBytes) : zonePixels;
+    uint16_t indexedSize = 0;
+
+    // A delta of a few pixels compresses to almost nothing. Otherwise, prefer a palette if the zone has only
+    // a few colors. A delta of up to half of the pixels still compresses better than the zone itself.
+    if (changedPixels <= zonePixels / 16)
+    {
+      pBuffer[position++] = ZEDMD_ZONE_ENCODING::ZoneXorDelta;
+      position += zoneBytes;
+    }
+    else if (indexed && (indexedSize = EncodeIndexed(&pBuffer[position + 1], pZone, zoneBytes)) > 0)
+    {
+      pBuffer[position++] = ZEDMD_ZONE_ENCODING::ZoneIndexed;
+      position += indexedSize;
+    }
+    else if (changedPixels <= zonePixels / 2)
+    {
+      pBuffer[position++] = ZEDMD_ZONE_ENCODING::ZoneXorDelta;
+      position += zoneBytes;
+    }
+    else
+    {
+      pBuffer[position++] = ZEDMD_ZONE_ENCODING::ZoneRaw;
+      memcpy(&pBuffer[position], pZone, zoneBytes);
+      position += zoneBytes;
+    }
+  }
+  else
+  {
+    pBuffer[position++] = idx;
+    memcpy(&pBuffer[position], pZone, zoneBytes);
+    position += zoneBytes;
+  }
+
+  return position;
+}
+
+bool ZeDMDComm::QueueDirtyZones()
+{
+  m_dirtyZonesMutex.lock();
+  if (0 == m_numDirtyZones)
+  {
+    m_dirtyZonesMutex.unlock();
+    return false;
+  }
+
+  const bool encoded = (m_capabilities & (ZEDMD_COMM_CAPABILITY::XorDeltaZones | ZEDMD_COMM_CAPABILITY::IndexedZones |
+                                          ZEDMD_COMM_CAPABILITY::SolidZones));
+  const uint16_t bufferSizeThreshold = ZEDMD_ZONES_BYTE_LIMIT - (m_zoneWidth * m_zoneHeight * 2 + (encoded ? 2 : 1));
+  uint8_t* buffer = m_dirtyZonesScratch;
+  uint16_t bufferPosition = 0;
+  ZeDMDFrame& frame = m_dirtyFrame;
+  frame.Reset(encoded ? ZEDMD_COMM_COMMAND::RGB565EncodedZonesStream : ZEDMD_COMM_COMMAND::RGB565ZonesStream);
+  // The dirty zones show the content of the latest frame.
+  frame.submitted = m_dirtySubmitted;
+  frame.tickets.swap(m_dirtyTickets);
+
+  memset(buffer, 0, ZEDMD_ZONES_BYTE_LIMIT);
+  for (uint8_t idx = 0; idx < 128; idx++)
+  {
+    ZeDMDDirtyZone& dirtyZone = m_dirtyZones[idx];
+    if (!dirtyZone.dirty) continue;
+
+    // The retained contents belong to the caller's thread, so the dirty zones are sent without a delta.
+    bufferPosition += AppendZone(&buffer[bufferPosition], idx, dirtyZone.data, dirtyZone.solid, false);
+    dirtyZone.dirty = false;
+    if (bufferPosition > bufferSizeThreshold)
+    {
+      frame.data.emplace_back(&m_chunkPool, buffer, bufferPosition);
+      memset(buffer, 0, ZEDMD_ZONES_BYTE_LIMIT);
+      bufferPosition = 0;
+    }
+  }
+  m_numDirtyZones = 0;
+
+  if (bufferPosition > 0)
+  {
+    frame.data.emplace_back(&m_chunkPool, buffer, bufferPosition);
+  }
+
+  // The frames queue is locked by the caller, so no frame of QueueFrame() gets in between.
+  m_frames.Push(frame);
+  m_dirtyZonesMutex.unlock();
+
+  return true;
+}
+
+void ZeDMDComm::DiscardDirtyZones()
+{
+  m_dirtyZonesMutex.lock();
+  for (uint8_t idx = 0; idx < 128; idx++)
+  {
+    m_dirtyZones[idx].dirty = false;
+  }
+  m_numDirtyZones = 0;
+  m_supersededTickets.swap(m_dirtyTickets);
+  m_dirtyZonesMutex.unlock();
+
+  // Taking the queue lock once ensures that a caller blocked in AcceptFrame() doesn't miss the notification.
+  m_frameQueueMutex.lock();
+  m_frameQueueMutex.unlock();
+  m_frameQueueCondition.notify_all();
+
+  CompleteTickets(m_supersededTickets, ZEDMD_STATUS_SUPERSEDED);
+  m_supersededTickets.clear();
+}
+
+// A geometry of 0 means that the runtime geometry is used, any other value gets the loops fully unrolled.
+template <uint16_t width, uint8_t zoneWidth, uint8_t zoneHeight>
+bool ZeDMDComm::ExtractZone(const uint8_t* pFrame, uint16_t x, uint16_t y, uint8_t* pZone)
+{
+  const uint16_t frameWidth = width ? width : m_width;
+  const uint8_t rowPixels = zoneWidth ? zoneWidth : m_zoneWidth;
+  const uint8_t rows = zoneHeight ? zoneHeight : m_zoneHeight;
+
+  for (uint8_t z = 0; z < rows; z++)
+  {
+    memcpy(&pZone[z * rowPixels * 2], &pFrame[((y + z) * frameWidth + x) * 2], rowPixels * 2);
+  }
+
+  // Compare without branching, which allows the compiler to vectorize the fixed size loops.
+  uint8_t different = 0;
+  for (uint16_t i = 2; i < rowPixels * rows * 2; i += 2)
+  {
+    different |= (pZone[i] ^ pZone[0]) | (pZone[i + 1] ^ pZone[1]);
+  }
+
+  return 0 == different;
+}
+
+template <uint8_t zoneWidth, uint8_t zoneHeight>
+uint64_t ZeDMDComm::HashZone(const uint8_t* pZone, bool solid)
+{
+  // Solid zones are identified by their color, which results in "1" as hash for black.
+  if (solid) return (((uint64_t)(pZone[0] | (pZone[1] << 8))) << 1) | 1;
+
+  return komihash(pZone, (zoneWidth ? zoneWidth : m_zoneWidth) * (zoneHeight ? zoneHeight : m_zoneHeight) * 2, 0);
+}
+
+// Hashes the zones from column left to right and row top to bottom, both exclusive, of the 16x8 zones grid.
+template <uint16_t width, uint16_t height>
+void ZeDMDComm::HashZones(const uint8_t* pFrame, uint8_t left, uint8_t top, uint8_t right, uint8_t bottom)
+{
+  constexpr uint8_t zoneWidth = width / 16;
+  constexpr uint8_t zoneHeight = height / 8;
+  uint8_t zone[ZEDMD_ZONE_BYTES_MAX];
+
+  for (uint8_t row = top; row < bottom; row++)
+  {
+    for (uint8_t column = left; column < right; column++)
+    {
+      bool solid = ExtractZone<width, zoneWidth, zoneHeight>(pFrame, column * (zoneWidth ? zoneWidth : m_zoneWidth),
+                                                             row * (zoneHeight ? zoneHeight : m_zoneHeight), zone);
+      m_frameZoneHashes[row * 16 + column] = HashZone<zoneWidth, zoneHeight>(zone, solid);
+    }
+  }
+}
+
+void ZeDMDComm::SelectZonePipeline()
+{
+  // The standard panels get their own instances, any other geometry uses the generic one.
+  if (128 == m_width && 32 == m_height)
+  {
+    m_pHashZones = &ZeDMDComm::HashZones<128, 32>;
+  }
+  else if (256 == m_width && 64 == m_height)
+  {
+    m_pHashZones = &ZeDMDComm::HashZones<256, 64>;
+  }
+  else
+  {
+    m_pHashZones = &ZeDMDComm::HashZones<0, 0>;
+  }
+}
+
+uint32_t ZeDMDComm::CountShiftMismatches(const uint16_t* pFrame, uint16_t y, uint16_t height, int8_t dx, int8_t dy)
+{
+  const uint16_t* pPrevious = (const uint16_t*)m_previousFrame;
+  uint32_t mismatches = 0;
+
+  for (uint16_t row = y; row < y + height; row++)
+  {
+    const int sourceRow = row - dy;
+    for (uint16_t x = 0; x < m_width; x++)
+    {
+      // Pixels shifted into the region from outside are black.
+      const int sourceX = x - dx;
+      uint16_t shiftedPixel = (sourceRow >= y && sourceRow < y + height && sourceX >= 0 && sourceX < m_width)
+                                  ? pPrevious[sourceRow * m_width + sourceX]
+                                  : 0;
+      if (pFrame[row * m_width + x] != shiftedPixel) mismatches++;
+    }
+  }
+
+  return mismatches;
+}
+
+void ZeDMDComm::ShiftRegion(uint16_t y, uint16_t height, int8_t dx, int8_t dy)
+{
+  // Regions span full rows, so the shift could be done in place, vertically first, then horizontally.
+  const uint16_t rowBytes = m_width * 2;
+  uint8_t* pRegion = &m_previousFrame[y * rowBytes];
+  const uint16_t rowsKept = (abs(dy) < height) ? height - abs(dy) : 0;
+  if (dy > 0)
+  {
+    memmove(&pRegion[dy * rowBytes], pRegion, rowsKept * rowBytes);
+    memset(pRegion, 0, (height - rowsKept) * rowBytes);
+  }
+  else if (dy < 0)
+  {
+    memmove(pRegion, &pRegion[-dy * rowBytes], rowsKept * rowBytes);
+    memset(&pRegion[rowsKept * rowBytes], 0, (height - rowsKept) * rowBytes);
+  }
+
+  const uint16_t pixelsKept = (abs(dx) < m_width) ? m_width - abs(dx) : 0;
+  for (uint16_t row = 0; dx != 0 && row < height; row++)
+  {
+    uint8_t* pRow = &pRegion[row * rowBytes];
+    if (dx > 0)
+    {
+      memmove(&pRow[dx * 2], pRow, pixelsKept * 2);
+      memset(pRow, 0, (m_width - pixelsKept) * 2);
+    }
+    else
+    {
+      memmove(pRow, &pRow[-dx * 2], pixelsKept * 2);
+      memset(&pRow[pixelsKept * 2], 0, (m_width - pixelsKept) * 2);
+    }
+  }
+
+  // The shift changed the zones on ZeDMD, so their hashes and retained contents need to follow.
+  uint8_t idx = (y / m_zoneHeight) * (m_width / m_zoneWidth);
+  for (uint16_t zoneY = y; zoneY < y + height; zoneY += m_zoneHeight)
+  {
+    for (uint16_t zoneX = 0; zoneX < m_width; zoneX += m_zoneWidth)
+    {
+      bool solid = ExtractZone(m_previousFrame, zoneX, zoneY, m_zoneContents[idx]);
+      m_zoneHashes[idx] = HashZone(m_zoneContents[idx], solid);
+      idx++;
+    }
+  }
+}
+
+uint16_t ZeDMDComm::DetectShifts(const uint8_t* pFrame, uint8_t* pRegions)
+{
+  const uint16_t* pPixels = (const uint16_t*)pFrame;
+  uint8_t numRegions = 0;
+  uint16_t position = 1;
+
+  auto addRegion = [&](uint16_t y, uint16_t height, int8_t dx, int8_t dy)
+  {
+    // x, y, width, height, dx, dy
+    const uint16_t values[] = {0, y, m_width, height};
+    for (uint16_t value : values)
+    {
+      pRegions[position++] = (uint8_t)(value >> 8 & 0xFF);
+      pRegions[position++] = (uint8_t)(value & 0xFF);
+    }
+    pRegions[position++] = (uint8_t)dx;
+    pRegions[position++] = (uint8_t)dy;
+    numRegions++;
+
+    ShiftRegion(y, height, dx, dy);
+  };
+
+  // A shift needs to explain the new frame a lot better than the unshifted content does.
+  uint32_t unshifted = CountShiftMismatches(pPixels, 0, m_height, 0, 0);
+  if (0 == unshifted) return 0;
+
+  uint32_t best = unshifted;
+  int8_t bestDy = 0;
+  for (int8_t dy = -ZEDMD_COMM_SHIFT_MAX_DY; dy <= ZEDMD_COMM_SHIFT_MAX_DY; dy++)
+  {
+    if (0 == dy) continue;
+    uint32_t mismatches = CountShiftMismatches(pPixels, 0, m_height, 0, dy);
+    if (mismatches < best)
+    {
+      best = mismatches;
+      bestDy = dy;
+    }
+  }
+
+  if (best * 2 < unshifted)
+  {
+    addRegion(0, m_height, 0, bestDy);
+  }
+  else
+  {
+    // Marquees often scroll horizontally in single lines, so each row of zones is checked on its own.
+    for (uint16_t y = 0; y < m_height; y += m_zoneHeight)
+    {
+      unshifted = CountShiftMismatches(pPixels, y, m_zoneHeight, 0, 0);
+      if (0 == unshifted) continue;
+
+      best = unshifted;
+      int8_t bestDx = 0;
+      for (int8_t dx = -ZEDMD_COMM_SHIFT_MAX_DX; dx <= ZEDMD_COMM_SHIFT_MAX_DX; dx++)
+      {
+        if (0 == dx) continue;
+        uint32_t mismatches = CountShiftMismatches(pPixels, y, m_zoneHeight, dx, 0);
+        if (mismatches < best)
+        {
+          best = mismatches;
+          bestDx = dx;
+        }
+      }
+
+      if (best * 2 < unshifted)
+      {
+        addRegion(y, m_zoneHeight, bestDx, 0);
+      }
+    }
+  }
+
+  if (0 == numRegions) return 0;
+
+  pRegions[0] = numRegions;
+  return position;
+}
+
+uint16_t ZeDMDComm::EncodeXorDelta(uint8_t* pDelta, const uint8_t* pZone, const uint8_t* pPrevious,
+                                   uint16_t zoneBytes)
+{
+  uint16_t changedPixels = 0;
+  for (uint16_t i = 0; i < zoneBytes; i += 2)
+  {
+    pDelta[i] = pZone[i] ^ pPrevious[i];
+    pDelta[i + 1] = pZone[i + 1] ^ pPrevious[i + 1];
+    if (pDelta[i] | pDelta[i + 1]) changedPixels++;
+  }
+
+  return changedPixels;
+}
+
+uint16_t ZeDMDComm::EncodeIndexed(uint8_t* pData, const uint8_t* pZone, uint16_t zoneBytes)
+{
+  uint16_t palette[16];
+  uint8_t indices[ZEDMD_ZONE_BYTES_MAX / 2];
+  uint8_t colors = 0;
+  const uint16_t zonePixels = zoneBytes / 2;
+
+  for (uint16_t i = 0; i < zonePixels; i++)
+  {
+    uint16_t color = pZone[i * 2] | (pZone[i * 2 + 1] << 8);
+    uint8_t c = 0;
+    while (c < colors && palette[c] != color) c++;
+    if (c == colors)
+    {
+      // Too many colors, nothing has been written yet.
+      if (colors == 16) return 0;
+      palette[colors++] = color;
+    }
+    indices[i] = c;
+  }
+
+  const uint8_t bits = (colors <= 2) ? 1 : ((colors <= 4) ? 2 : 4);
+  const uint8_t pixelsPerByte = 8 / bits;
+  uint16_t position = 0;
+
+  pData[position++] = colors;
+  for (uint8_t c = 0; c < colors; c++)
+  {
+    pData[position++] = palette[c] & 0xFF;
+    pData[position++] = palette[c] >> 8;
+  }
+
+  for (uint16_t i = 0; i < zonePixels; i += pixelsPerByte)
+  {
+    uint8_t packed = 0;
+    for (uint8_t p = 0; p < pixelsPerByte; p++)
+    {
+      packed = (packed << bits) | indices[i + p];
+    }
+    pData[position++] = packed;
+  }
+
+  return position;
+}
+
+void ZeDMDComm::ResetZones(uint8_t hash)
+{
+  memset(m_zoneHashes, hash, sizeof(m_zoneHashes));
+  m_zoneHashesValid = false;
+  // Without a complete frame, the retained zone contents don't match the display anymore.
+  m_zoneContentsValid = false;
+}
+
+bool ZeDMDComm::IsZonesStream(uint8_t command)
+{
+  return ZEDMD_COMM_COMMAND::RGB565ZonesStream == command || ZEDMD_COMM_COMMAND::RGB565EncodedZonesStream == command;
+}
+
+bool ZeDMDComm::IsRepaintCommand(uint8_t command)
+{
+  // These commands change what ZeDMD displays, so they need to stay in order with the frames.
+  switch (command)
+  {
+    case ZEDMD_COMM_COMMAND::ClearScreen:
+    case ZEDMD_COMM_COMMAND::LEDTest:
+    case ZEDMD_COMM_COMMAND::Reset:
+    case ZEDMD_COMM_COMMAND::FrameSize:
+    case ZEDMD_COMM_COMMAND::EnableUpscaling:
+    case ZEDMD_COMM_COMMAND::DisableUpscaling:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void ZeDMDComm::SetStreamingCompression(bool enable)
+{
+  m_streamingCompression.store(enable, std::memory_order_release);
+}
+
+void ZeDMDComm::SetFramePacing(uint8_t fps, uint16_t latencyBudget)
+{
+  m_frameInterval.store((fps > 0) ? 1000000 / fps : 0, std::memory_order_release);
+  m_latencyBudget.store(latencyBudget * 1000, std::memory_order_release);
+
+  // A larger budget might let a blocked caller continue.
+  m_frameQueueMutex.lock();
+  m_frameQueueMutex.unlock();
+  m_frameQueueCondition.notify_all();
+}
+
+bool ZeDMDComm::IsBehind()
+{
+  m_frameQueueMutex.lock();
+  const size_t queued = m_frames.Size();
+  m_frameQueueMutex.unlock();
+
+  return IsBehind(queued);
+}
+
+bool ZeDMDComm::IsBehind(size_t queued)
+{
+  bool behind = (queued >= ZEDMD_COMM_FRAME_QUEUE_SIZE_MAX);
+
+  // With frame pacing, every queued frame takes one frame interval. A frame which would miss its deadline is
+  // superseded by the newer ones.
+  const uint32_t interval = m_frameInterval.load(std::memory_order_relaxed);
+  const uint32_t latencyBudget = m_latencyBudget.load(std::memory_order_relaxed);
+  if (interval > 0 && latencyBudget > 0 && (queued + 1) * interval > latencyBudget) behind = true;
 
-    // If ZeDMD is already behind, clear the screen immediately.
-    if (FillDelayed())
-    {
-      m_frameQueueMutex.lock();
-      while (!m_frames.empty())
-      {
-        m_frames.pop();
-      }
-      m_frameQueueMutex.unlock();
+  // Frames must not overtake the dirty zones, otherwise their deltas would be applied to outdated zones.
+  m_dirtyZonesMutex.lock();
+  behind = behind || (m_numDirtyZones > 0);
+  m_dirtyZonesMutex.unlock();
 
-      // "Delete" delayed frame.
-      m_delayedFrameMutex.lock();
-      m_delayedFrameReady = false;
-      m_delayedFrameMutex.unlock();
-    }
+  return behind;
+}
 
-    m_frameQueueMutex.lock();
-    m_frames.push(std::move(frame));
-    m_frameQueueMutex.unlock();
+void ZeDMDComm::SetSubmitPolicy(ZEDMD_SUBMIT_POLICY policy) { m_submitPolicy = policy; }
 
-    // Use "1" as hash for black.
-    memset(m_zoneHashes, 1, sizeof(m_zoneHashes));
+void ZeDMDComm::SetThreadPriority(ZEDMD_THREAD_PRIORITY priority)
+{
+  m_threadSettingsMutex.lock();
+  m_threadPriority = priority;
+  m_threadSettingsMutex.unlock();
+  m_threadSettingsChanged.store(true, std::memory_order_release);
+}
 
-    return;
-  }
+void ZeDMDComm::SetThreadAffinity(uint32_t cpuMask)
+{
+  m_threadSettingsMutex.lock();
+  m_threadAffinity = cpuMask;
+  m_threadSettingsMutex.unlock();
+  m_threadSettingsChanged.store(true, std::memory_order_release);
+}
 
-  uint8_t idx = 0;
-  uint16_t zonesBytesLimit = ZEDMD_ZONES_BYTE_LIMIT;
-  const uint16_t zoneBytes = m_zoneWidth * m_zoneHeight * 2;
-  const uint16_t zoneBytesTotal = zoneBytes + 1;
-  uint8_t* zone = (uint8_t*)malloc(zoneBytes);
-  uint8_t* buffer = (uint8_t*)malloc(zonesBytesLimit);
-  uint16_t bufferPosition = 0;
-  const uint16_t bufferSizeThreshold = zonesBytesLimit - zoneBytesTotal;
+void ZeDMDComm::SetThreadName(const char* name)
+{
+  m_threadSettingsMutex.lock();
+  // Thread names are limited to 15 characters on Linux.
+  strncpy(m_threadName, name, sizeof(m_threadName) - 1);
+  m_threadName[sizeof(m_threadName) - 1] = 0;
+  m_threadSettingsMutex.unlock();
+  m_threadSettingsChanged.store(true, std::memory_order_release);
+}
 
-  ZeDMDFrame frame(ZEDMD_COMM_COMMAND::RGB565ZonesStream);
+void ZeDMDComm::ApplyThreadSettings()
+{
+  m_threadSettingsMutex.lock();
+  ZEDMD_THREAD_PRIORITY priority = m_threadPriority;
+  const uint32_t cpuMask = m_threadAffinity;
+  char name[sizeof(m_threadName)];
+  memcpy(name, m_threadName, sizeof(name));
+  m_threadSettingsMutex.unlock();
+
+  // Each setting falls back gracefully if it isn't permitted or supported, the thread just keeps running as it is.
+#if defined(_WIN32) || defined(_WIN64)
+  const int winPriority = (ZEDMD_PRIORITY_REALTIME == priority) ? THREAD_PRIORITY_TIME_CRITICAL
+                          : (ZEDMD_PRIORITY_HIGH == priority)   ? THREAD_PRIORITY_HIGHEST
+                                                                        : THREAD_PRIORITY_NORMAL;
+  if (!::SetThreadPriority(GetCurrentThread(), winPriority))
+  {
+    Log("ZeDMD thread priority %d not permitted", priority);
+  }
 
-  bool delayed = FillDelayed();
-  if (delayed)
+  if (cpuMask && 0 == SetThreadAffinityMask(GetCurrentThread(), cpuMask))
   {
-    // A delayed frame needs to be complete.
-    memset(m_zoneHashes, 0, sizeof(m_zoneHashes));
+    Log("ZeDMD thread affinity 0x%08x could not be set", cpuMask);
   }
 
-  memset(buffer, 0, zonesBytesLimit);
-  for (uint16_t y = 0; y < m_height; y += m_zoneHeight)
+  // SetThreadDescription() is available since Windows 10 1607 only.
+  typedef HRESULT(WINAPI * SetThreadDescriptionFunc)(HANDLE, PCWSTR);
+  SetThreadDescriptionFunc setThreadDescription =
+      (SetThreadDescriptionFunc)GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "SetThreadDescription");
+  if (setThreadDescription && name[0])
   {
-    for (uint16_t x = 0; x < m_width; x += m_zoneWidth)
+    wchar_t wideName[sizeof(name)];
+    MultiByteToWideChar(CP_UTF8, 0, name, -1, wideName, sizeof(name));
+    setThreadDescription(GetCurrentThread(), wideName);
+  }
+#else
+  struct sched_param param;
+  memset(&param, 0, sizeof(param));
+  if (ZEDMD_PRIORITY_REALTIME == priority)
+  {
+    param.sched_priority = ZEDMD_COMM_THREAD_REALTIME_PRIORITY;
+    if (0 != pthread_setschedparam(pthread_self(), SCHED_FIFO, &param))
     {
-      for (uint8_t z = 0; z < m_zoneHeight; z++)
-      {
-        memcpy(&zone[z * m_zoneWidth * 2], &data[((y + z) * m_width + x) * 2], m_zoneWidth * 2);
-      }
-
-      bool black = (0 == memcmp(zone, m_allBlack, zoneBytes));
-      // Use "1" as hash for black.
-      uint64_t hash = black ? 1 : komihash(zone, zoneBytes, 0);
-      if (hash != m_zoneHashes[idx])
-      {
-        m_zoneHashes[idx] = hash;
+      // Usually requires CAP_SYS_NICE or an rtprio limit.
+      Log("ZeDMD realtime thread priority not permitted, falling back to high priority");
+      priority = ZEDMD_PRIORITY_HIGH;
+      param.sched_priority = 0;
+    }
+  }
+  if (ZEDMD_PRIORITY_REALTIME != priority)
+  {
+    pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+  }
 
-        if (black)
-        {
-          // In case of a full black zone, just send the zone index ID and add 128.
-          buffer[bufferPosition++] = idx + 128;
-        }
-        else
-        {
-          buffer[bufferPosition++] = idx;
-          memcpy(&buffer[bufferPosition], zone, zoneBytes);
-          bufferPosition += zoneBytes;
-        }
+#if defined(__APPLE__)
+  // There are no nice values per thread, the quality of service class is the closest equivalent.
+  if (ZEDMD_PRIORITY_REALTIME != priority)
+  {
+    pthread_set_qos_class_self_np(
+        (ZEDMD_PRIORITY_HIGH == priority) ? QOS_CLASS_USER_INTERACTIVE : QOS_CLASS_DEFAULT, 0);
+  }
 
-        if (bufferPosition > bufferSizeThreshold)
-        {
-          frame.data.emplace_back(buffer, bufferPosition);
-          memset(buffer, 0, zonesBytesLimit);
-          bufferPosition = 0;
-        }
-      }
+  if (cpuMask) Log("ZeDMD thread affinity is not supported on this platform");
 
-      idx++;
+  if (name[0]) pthread_setname_np(name);
+#else
+  if (ZEDMD_PRIORITY_REALTIME != priority)
+  {
+    // On Linux, the nice value of a thread could be set using its thread ID.
+    const int nice = (ZEDMD_PRIORITY_HIGH == priority) ? ZEDMD_COMM_THREAD_HIGH_PRIORITY_NICE : 0;
+    if (0 != setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), nice))
+    {
+      Log("ZeDMD thread nice value %d not permitted", nice);
     }
   }
 
-  if (bufferPosition > 0)
+  if (cpuMask)
   {
-    frame.data.emplace_back(buffer, bufferPosition);
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (uint8_t cpu = 0; cpu < 32; cpu++)
+    {
+      if (cpuMask & (1u << cpu)) CPU_SET(cpu, &cpuSet);
+    }
+    if (0 != sched_setaffinity(0, sizeof(cpuSet), &cpuSet))
+    {
+      Log("ZeDMD thread affinity 0x%08x could not be set", cpuMask);
+    }
   }
 
-  free(buffer);
-  free(zone);
+  if (name[0]) pthread_setname_np(pthread_self(), name);
+#endif
+#endif
+}
 
-  if (delayed)
-  {
-    m_delayedFrameMutex.lock();
-    m_delayedFrame = std::move(frame);
-    m_delayedFrameReady = true;
-    m_delayedFrameMutex.unlock();
-  }
-  else
+bool ZeDMDComm::AcceptFrame()
+{
+  switch (m_submitPolicy)
   {
-    m_frameQueueMutex.lock();
-    m_frames.push(std::move(frame));
-    m_frameQueueMutex.unlock();
+    case ZEDMD_POLICY_BLOCK:
+    {
+      // The run thread makes room by streaming the queued frames and the dirty zones. It signals every frame it takes
+      // from the queue and fails the queue when it finishes.
+      std::unique_lock<std::mutex> lock(m_frameQueueMutex);
+      m_frameQueueCondition.wait(lock,
+                                 [this]()
+                                 {
+                                   return !IsBehind(m_frames.Size()) || !IsConnected() ||
+                                          m_stopFlag.load(std::memory_order_relaxed);
+                                 });
+      return true;
+    }
+
+    case ZEDMD_POLICY_FAIL_FAST:
+      return !IsBehind();
+
+    default:
+      return true;
   }
 }
 
-bool ZeDMDComm::FillDelayed()
+uint8_t ZeDMDComm::GetQueueDepth()
 {
-  uint8_t size = 0;
-  bool delayed = false;
   m_frameQueueMutex.lock();
-  size = m_frames.size();
-  delayed = m_delayedFrameReady || (size >= ZEDMD_COMM_FRAME_QUEUE_SIZE_MAX);
+  size_t queued = m_frames.Size();
   m_frameQueueMutex.unlock();
-  if (delayed) Log("ZeDMD, next frame will be delayed");
-  return delayed;
+
+  // The dirty zones will be sent as one more frame.
+  m_dirtyZonesMutex.lock();
+  if (m_numDirtyZones > 0) queued++;
+  m_dirtyZonesMutex.unlock();
+
+  return (uint8_t)std::min<size_t>(queued, UINT8_MAX);
 }
 
 void ZeDMDComm::IgnoreDevice(const char* ignore_device)
@@ -452,6 +1380,35 @@ bool ZeDMDComm::Connect(char* pDevice)
 }
 
 bool ZeDMDComm::Handshake(char* pDevice)
+{
+  uint16_t width;
+  uint16_t height;
+  if (!SendHandshake(&width, &height))
+  {
+    return false;
+  }
+
+  m_width = width;
+  m_height = height;
+  m_zoneWidth = m_width / 16;
+  m_zoneHeight = m_height / 8;
+
+  // Store the device name for reconnects.
+  SetDevice(pDevice);
+  Log("ZeDMD found: %sdevice=%s, width=%d, height=%d", m_s3 ? "S3 " : "", pDevice, m_width, m_height);
+
+  // The run thread isn't running yet, so the capabilities could be used right away.
+  m_deviceCapabilities.store(QueryCapabilities(), std::memory_order_release);
+  m_capabilities = m_deviceCapabilities.load(std::memory_order_relaxed);
+  SelectZonePipeline();
+
+  // Next streaming needs to be complete.
+  ResetZones(0);
+
+  return true;
+}
+
+bool ZeDMDComm::SendHandshake(uint16_t* pWidth, uint16_t* pHeight)
 {
 #if !(                                                                                                                \
     (defined(__APPLE__) && ((defined(TARGET_OS_IOS) && TARGET_OS_IOS) || (defined(TARGET_OS_TV) && TARGET_OS_TV))) || \
@@ -474,20 +1431,11 @@ bool ZeDMDComm::Handshake(char* pDevice)
 
  if (sp_blocking_read(m_pSerialPort, data, 8, ZEDMD_COMM_SERIAL_READ_TIMEOUT) && memcmp(data, CTRL_CHARS_HEADER, 4) == 0) {
 
-    m_width = data[4] + data[5] * 256;
-    m_height = data[6] + data[7] * 256;
-    m_zoneWidth = m_width / 16;
-    m_zoneHeight = m_height / 8;
+    *pWidth = data[4] + data[5] * 256;
+    *pHeight = data[6] + data[7] * 256;
 
     if (sp_blocking_read(m_pSerialPort, data, 1, ZEDMD_COMM_SERIAL_READ_TIMEOUT) && data[0] == 'R')
     {
-      // Store the device name for reconnects.
-      SetDevice(pDevice);
-      Log("ZeDMD found: %sdevice=%s, width=%d, height=%d", m_s3 ? "S3 " : "", pDevice, m_width, m_height);
-
-      // Next streaming needs to be complete.
-      memset(m_zoneHashes, 0, sizeof(m_zoneHashes));
-
       return true;
     }
   }
@@ -496,6 +1444,73 @@ bool ZeDMDComm::Handshake(char* pDevice)
   return false;
 }
 
+void ZeDMDComm::Reconnect()
+{
+#if !(                                                                                                                \
+    (defined(__APPLE__) && ((defined(TARGET_OS_IOS) && TARGET_OS_IOS) || (defined(TARGET_OS_TV) && TARGET_OS_TV))) || \
+    defined(__ANDROID__))
+  // This runs on the run thread, so the reset is written directly instead of being queued behind the frames.
+  uint8_t data[CTRL_CHARS_HEADER_SIZE + 1];
+  memcpy(data, CTRL_CHARS_HEADER, CTRL_CHARS_HEADER_SIZE);
+  data[CTRL_CHARS_HEADER_SIZE] = ZEDMD_COMM_COMMAND::Reset;
+  sp_blocking_write(m_pSerialPort, (void*)data, CTRL_CHARS_HEADER_SIZE + 1, ZEDMD_COMM_SERIAL_WRITE_TIMEOUT);
+
+  // Wait a bit to let ZeDMD restart.
+  std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+  Log("Resetted device");
+
+  // The zone pipeline and the queued frames depend on the geometry, so it has to stay the same.
+  uint16_t width;
+  uint16_t height;
+  if (SendHandshake(&width, &height) && width == m_width && height == m_height)
+  {
+    // The capabilities are adopted by the thread queueing the frames.
+    m_deviceCapabilities.store(QueryCapabilities(), std::memory_order_release);
+    m_noAcknowledgeCounter = 0;
+  }
+  else
+  {
+    Log("ZeDMD handshake after reset failed");
+  }
+#endif
+
+  // ZeDMD lost its content, so the next frame needs to be complete.
+  m_resyncFlag.store(true, std::memory_order_release);
+}
+
+uint8_t ZeDMDComm::QueryCapabilities()
+{
+  uint8_t capabilities = 0;
+
+#if !(                                                                                                                \
+    (defined(__APPLE__) && ((defined(TARGET_OS_IOS) && TARGET_OS_IOS) || (defined(TARGET_OS_TV) && TARGET_OS_TV))) || \
+    defined(__ANDROID__))
+  uint8_t data[CTRL_CHARS_HEADER_SIZE + 1] = {0};
+
+  data[0] = ZEDMD_COMM_COMMAND::GetCapabilities;
+  sp_nonblocking_write(m_pSerialPort, (void*)CTRL_CHARS_HEADER, CTRL_CHARS_HEADER_SIZE);
+  sp_blocking_write(m_pSerialPort, (void*)data, 1, ZEDMD_COMM_SERIAL_WRITE_TIMEOUT);
+
+  // The response is the control header followed by the capability bits. Older firmware doesn't know the command.
+  if (sp_blocking_read(m_pSerialPort, data, CTRL_CHARS_HEADER_SIZE + 1, ZEDMD_COMM_SERIAL_READ_TIMEOUT * 4) ==
+          CTRL_CHARS_HEADER_SIZE + 1 &&
+      memcmp(data, CTRL_CHARS_HEADER, CTRL_CHARS_HEADER_SIZE) == 0)
+  {
+    capabilities = data[CTRL_CHARS_HEADER_SIZE];
+  }
+  else
+  {
+    // Drop any error response, otherwise it would be taken as response to the next command.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    sp_flush(m_pSerialPort, SP_BUF_INPUT);
+  }
+
+  Log("ZeDMD capabilities: %d", capabilities);
+#endif
+
+  return capabilities;
+}
+
 bool ZeDMDComm::IsConnected()
 {
 #if !(                                                                                                                \
@@ -563,11 +1578,33 @@ bool ZeDMDComm::StreamBytes(ZeDMDFrame* pFrame)
   uint8_t* pData;
   uint16_t size;
 
+  // All chunks of a frame share one deflate stream to benefit from matches across chunk boundaries.
+  mz_stream stream;
+  bool streaming = IsZonesStream(pFrame->command) &&
+                   (m_deviceCapabilities.load(std::memory_order_relaxed) & ZEDMD_COMM_CAPABILITY::StreamingDeflate) &&
+                   m_streamingCompression.load(std::memory_order_relaxed);
+  bool continued = false;
+  if (streaming)
+  {
+    memset(&stream, 0, sizeof(stream));
+    streaming = (MZ_OK == mz_deflateInit(&stream, MZ_DEFAULT_COMPRESSION));
+  }
+
   for (auto it = pFrame->data.rbegin(); it != pFrame->data.rend(); ++it)
   {
-    ZeDMDFrameData frameData = *it;
+    const ZeDMDFrameData& frameData = *it;
+
+    if (streaming)
+    {
+      if (!SendStreamedZonesChunk(pFrame->command, frameData.data, frameData.size, &stream, &continued))
+      {
+        mz_deflateEnd(&stream);
+        return false;
+      }
 
-    if (pFrame->command != ZEDMD_COMM_COMMAND::RGB565ZonesStream)
+      continue;
+    }
+    else if (!IsZonesStream(pFrame->command))
     {
       size = CTRL_CHARS_HEADER_SIZE + 1 + frameData.size;
       pData = (uint8_t*)malloc(size);
@@ -580,30 +1617,12 @@ bool ZeDMDComm::StreamBytes(ZeDMDFrame* pFrame)
     }
     else
     {
-      size = CTRL_CHARS_HEADER_SIZE + 1;
-      pData = (uint8_t*)malloc(size);
-      memcpy(pData, CTRL_CHARS_HEADER, CTRL_CHARS_HEADER_SIZE);
-      pData[CTRL_CHARS_HEADER_SIZE] = ZEDMD_COMM_COMMAND::AnnounceRGB565ZonesStream;
+      if (!SendZonesChunk(pFrame->command, frameData.data, frameData.size)) return false;
 
-      bool success = SendChunks(pData, size);
-      free(pData);
-      if (!success) return false;
+      // Every chunk is complete on its own, so pending commands don't need to wait for the rest of the frame.
+      StreamCommands();
 
-      mz_ulong compressedSize = mz_compressBound(ZEDMD_ZONES_BYTE_LIMIT);
-      pData = (uint8_t*)malloc(CTRL_CHARS_HEADER_SIZE + 3 + ZEDMD_ZONES_BYTE_LIMIT);
-      memcpy(pData, CTRL_CHARS_HEADER, CTRL_CHARS_HEADER_SIZE);
-      pData[CTRL_CHARS_HEADER_SIZE] = pFrame->command;
-      mz_compress(pData + CTRL_CHARS_HEADER_SIZE + 3, &compressedSize, frameData.data, frameData.size);
-      size = CTRL_CHARS_HEADER_SIZE + 3 + compressedSize;
-      pData[CTRL_CHARS_HEADER_SIZE + 1] = (uint8_t)(compressedSize >> 8 & 0xFF);
-      pData[CTRL_CHARS_HEADER_SIZE + 2] = (uint8_t)(compressedSize & 0xFF);
-      if ((0 == pData[CTRL_CHARS_HEADER_SIZE + 1] && 0 == pData[CTRL_CHARS_HEADER_SIZE + 2]) ||
-          compressedSize > (ZEDMD_ZONES_BYTE_LIMIT))
-      {
-        Log("Compression error");
-        free(pData);
-        return false;
-      }
+      continue;
     }
 
     bool success = SendChunks(pData, size);
@@ -611,16 +1630,19 @@ bool ZeDMDComm::StreamBytes(ZeDMDFrame* pFrame)
     if (!success) return false;
   }
 
-  if (m_s3 && pFrame->command == ZEDMD_COMM_COMMAND::RGB565ZonesStream)
+  if (streaming)
+  {
+    mz_deflateEnd(&stream);
+  }
+
+  if (m_s3 && IsZonesStream(pFrame->command))
   {
     size = CTRL_CHARS_HEADER_SIZE + 1;
-    pData = (uint8_t*)malloc(size);
+    pData = m_chunkScratch;
     memcpy(pData, CTRL_CHARS_HEADER, CTRL_CHARS_HEADER_SIZE);
     pData[CTRL_CHARS_HEADER_SIZE] = ZEDMD_COMM_COMMAND::RenderRGB565Frame;
 
-    bool success = SendChunks(pData, size);
-    free(pData);
-    if (!success) return false;
+    if (!SendChunks(pData, size)) return false;
   }
 
   return true;
@@ -629,6 +1651,226 @@ bool ZeDMDComm::StreamBytes(ZeDMDFrame* pFrame)
 #endif
 }
 
+bool ZeDMDComm::SendZonesChunk(uint8_t command, uint8_t* pChunk, int chunkSize)
+{
+  // The chunk is split only after the scratch buffer isn't needed anymore, so the halves could reuse it.
+  uint8_t* pData = m_chunkScratch;
+  bool stored = false;
+  int encodedSize = EncodeChunk(pData + CTRL_CHARS_HEADER_SIZE + 3, ZEDMD_ZONES_BYTE_LIMIT, pChunk, chunkSize, &stored);
+
+  if (0 == encodedSize)
+  {
+    // Without stored chunks, split a chunk that doesn't compress well enough instead of dropping the frame.
+    int split = SplitChunk(command, pChunk, chunkSize);
+    if (split > 0)
+    {
+      return SendZonesChunk(command, pChunk, split) && SendZonesChunk(command, pChunk + split, chunkSize - split);
+    }
+
+    Log("Compression error");
+    return false;
+  }
+
+  uint16_t size = CTRL_CHARS_HEADER_SIZE + 1;
+  memcpy(pData, CTRL_CHARS_HEADER, CTRL_CHARS_HEADER_SIZE);
+  pData[CTRL_CHARS_HEADER_SIZE] = ZEDMD_COMM_COMMAND::AnnounceRGB565ZonesStream;
+
+  bool success = SendChunks(pData, size);
+  if (success)
+  {
+    size = CTRL_CHARS_HEADER_SIZE + 3 + encodedSize;
+    pData[CTRL_CHARS_HEADER_SIZE] = stored ? (command | ZEDMD_COMM_STORED_CHUNK) : command;
+    pData[CTRL_CHARS_HEADER_SIZE + 1] = (uint8_t)(encodedSize >> 8 & 0xFF);
+    pData[CTRL_CHARS_HEADER_SIZE + 2] = (uint8_t)(encodedSize & 0xFF);
+
+    success = SendChunks(pData, size);
+  }
+
+  return success;
+}
+
+bool ZeDMDComm::SendStreamedZonesChunk(uint8_t command, uint8_t* pChunk, int chunkSize, mz_stream_s* pStream,
+                                       bool* pContinued)
+{
+  if (!IsCompressible(pChunk, chunkSize))
+  {
+    // Send the chunk on its own, ZeDMD will start a new stream with the next chunk.
+    *pContinued = false;
+    return SendZonesChunk(command, pChunk, chunkSize);
+  }
+
+  if (!*pContinued)
+  {
+    mz_deflateReset(pStream);
+  }
+
+  uint8_t* pData = m_chunkScratch;
+  pStream->next_in = pChunk;
+  pStream->avail_in = chunkSize;
+  pStream->next_out = pData + CTRL_CHARS_HEADER_SIZE + 3;
+  pStream->avail_out = ZEDMD_ZONES_BYTE_LIMIT;
+
+  // The sync flush aligns the output to a byte boundary, so ZeDMD could inflate each chunk as soon as it arrives.
+  int status = mz_deflate(pStream, MZ_SYNC_FLUSH);
+  if (MZ_OK != status || pStream->avail_in > 0 || 0 == pStream->avail_out)
+  {
+    // The stream state doesn't match ZeDMD anymore, send the chunk on its own instead.
+    *pContinued = false;
+    return SendZonesChunk(command, pChunk, chunkSize);
+  }
+
+  const uint16_t encodedSize = ZEDMD_ZONES_BYTE_LIMIT - pStream->avail_out;
+  const uint16_t sizeField = encodedSize | (*pContinued ? ZEDMD_COMM_STREAMED_CHUNK : 0);
+
+  uint16_t size = CTRL_CHARS_HEADER_SIZE + 1;
+  memcpy(pData, CTRL_CHARS_HEADER, CTRL_CHARS_HEADER_SIZE);
+  pData[CTRL_CHARS_HEADER_SIZE] = ZEDMD_COMM_COMMAND::AnnounceRGB565ZonesStream;
+
+  bool success = SendChunks(pData, size);
+  if (success)
+  {
+    size = CTRL_CHARS_HEADER_SIZE + 3 + encodedSize;
+    pData[CTRL_CHARS_HEADER_SIZE] = command;
+    pData[CTRL_CHARS_HEADER_SIZE + 1] = (uint8_t)(sizeField >> 8 & 0xFF);
+    pData[CTRL_CHARS_HEADER_SIZE + 2] = (uint8_t)(sizeField & 0xFF);
+
+    success = SendChunks(pData, size);
+  }
+
+  *pContinued = success;
+  return success;
+}
+
+int ZeDMDComm::EncodeChunk(uint8_t* pEncoded, int maxSize, uint8_t* pData, int size, bool* pStored)
+{
+  *pStored = false;
+
+  if (!(m_deviceCapabilities.load(std::memory_order_relaxed) & ZEDMD_COMM_CAPABILITY::StoredChunks))
+  {
+    return CompressChunk(pEncoded, maxSize, pData, size);
+  }
+
+  int compressedSize = IsCompressible(pData, size) ? CompressChunk(pEncoded, maxSize, pData, size) : 0;
+  if (compressedSize > 0 && compressedSize < size)
+  {
+    return compressedSize;
+  }
+
+  // Pass the chunk through as it is, it doesn't get smaller by compressing it.
+  if (size > maxSize) return 0;
+  memcpy(pEncoded, pData, size);
+  *pStored = true;
+
+  return size;
+}
+
+bool ZeDMDComm::IsCompressible(const uint8_t* pData, int size)
+{
+  uint16_t histogram[256] = {0};
+  for (int i = 0; i < size; i++)
+  {
+    histogram[pData[i]]++;
+  }
+
+  // Estimate the order-0 entropy in bits per byte. Noise like video clips or dithered images gets close to 8.
+  double entropy = 0;
+  for (int i = 0; i < 256; i++)
+  {
+    if (histogram[i] > 0)
+    {
+      double p = (double)histogram[i] / size;
+      entropy -= p * log2(p);
+    }
+  }
+
+  return entropy < ZEDMD_COMM_INCOMPRESSIBLE_ENTROPY;
+}
+
+int ZeDMDComm::SplitChunk(uint8_t command, const uint8_t* pChunk, int chunkSize)
+{
+  const bool encoded = (ZEDMD_COMM_COMMAND::RGB565EncodedZonesStream == command);
+  const uint16_t zoneBytes = m_zoneWidth * m_zoneHeight * 2;
+  int position = 0;
+  int split = 0;
+
+  // Find the zone boundary closest to the middle of the chunk.
+  while (position < chunkSize)
+  {
+    if (position > 0 && abs(chunkSize - 2 * position) < abs(chunkSize - 2 * split))
+    {
+      split = position;
+    }
+
+    const uint8_t* pZone = &pChunk[position];
+    if (pZone[0] >= 128)
+    {
+      position += 1;
+    }
+    else if (!encoded)
+    {
+      position += 1 + zoneBytes;
+    }
+    else if (ZEDMD_ZONE_ENCODING::ZoneSolid == pZone[1])
+    {
+      position += 4;
+    }
+    else if (ZEDMD_ZONE_ENCODING::ZoneIndexed == pZone[1])
+    {
+      const uint8_t bits = (pZone[2] <= 2) ? 1 : ((pZone[2] <= 4) ? 2 : 4);
+      position += 3 + pZone[2] * 2 + zoneBytes / 2 * bits / 8;
+    }
+    else
+    {
+      position += 2 + zoneBytes;
+    }
+  }
+
+  return split;
+}
+
+int ZeDMDComm::CompressChunk(uint8_t* pCompressed, int maxSize, uint8_t* pData, int size)
+{
+  // Attract modes and animations loop the same frames, so identical chunks don't need to be compressed again.
+  uint64_t hash = komihash(pData, size, 0);
+  auto it = m_chunkCacheIndex.find(hash);
+  if (it != m_chunkCacheIndex.end())
+  {
+    // Move the chunk to the front, the least recently used chunk is at the end.
+    m_chunkCache.splice(m_chunkCache.begin(), m_chunkCache, it->second);
+    ZeDMDFrameData& cached = it->second->data;
+    if (cached.size <= maxSize)
+    {
+      memcpy(pCompressed, cached.data, cached.size);
+      m_chunkCacheHits.fetch_add(1, std::memory_order_relaxed);
+      return cached.size;
+    }
+  }
+
+  m_chunkCacheMisses.fetch_add(1, std::memory_order_relaxed);
+
+  mz_ulong compressedSize = maxSize;
+  if (MZ_OK != mz_compress(pCompressed, &compressedSize, pData, size))
+  {
+    return 0;
+  }
+
+  if (it == m_chunkCacheIndex.end())
+  {
+    m_chunkCache.emplace_front(hash, pCompressed, (int)compressedSize);
+    m_chunkCacheIndex[hash] = m_chunkCache.begin();
+    m_chunkCacheSize += compressedSize;
+
+    while (m_chunkCacheSize > ZEDMD_COMM_CHUNK_CACHE_SIZE_MAX)
+    {
+      m_chunkCacheSize -= m_chunkCache.back().data.size;
+      m_chunkCacheIndex.erase(m_chunkCache.back().hash);
+      m_chunkCache.pop_back();
+    }
+  }
+
+  return compressedSize;
+}
+
 bool ZeDMDComm::SendChunks(uint8_t* pData, uint16_t size)
 {
 #if !(                                                                                                                \
@@ -673,9 +1915,7 @@ bool ZeDMDComm::SendChunks(uint8_t* pData, uint16_t size)
     {
       if (++m_noAcknowledgeCounter > 64)
       {
-        SoftReset();
-        Log("Resetted device", response);
-        Handshake(m_device);
+        Reconnect();
       }
       else
       {
@@ -695,3 +1935,11 @@ uint16_t const ZeDMDComm::GetWidth() { return m_width; }
 uint16_t const ZeDMDComm::GetHeight() { return m_height; }
 
 bool const ZeDMDComm::IsS3() { return m_s3; }
+
+uint32_t const ZeDMDComm::GetChunkCacheHits() { return m_chunkCacheHits.load(std::memory_order_relaxed); }
+
+uint32_t const ZeDMDComm::GetChunkCacheMisses() { return m_chunkCacheMisses.load(std::memory_order_relaxed); }
+
+float const ZeDMDComm::GetFps() { return m_fps.load(std::memory_order_relaxed); }
+
+uint32_t const ZeDMDComm::GetLatency() { return m_latency.load(std::memory_order_relaxed); }
@@ -14,13 +14,20 @@
 #include <stdarg.h>
 
 #include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstring>
+#include <list>
 #include <mutex>
 #include <queue>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include "ZeDMD.h"
+
 #ifdef _MSC_VER
 #define ZEDMDCALLBACK __stdcall
 #else
@@ -38,11 +45,33 @@
 #define ZEDMD_COMM_NUM_TIMEOUTS_TO_WAIT_FOR_ACKNOWLEDGE 3
 #define ZEDMD_COMM_FRAME_QUEUE_SIZE_MAX 8
 
+// A zones stream command with this flag set announces an uncompressed chunk.
+#define ZEDMD_COMM_STORED_CHUNK 0x80
+// Set in the size of a zones chunk to continue the deflate stream of the previous chunk of the frame, USB only.
+// Chunks without it start a new stream, which also covers chunks compressed on their own.
+#define ZEDMD_COMM_STREAMED_CHUNK 0x8000
+// Chunks with a higher estimated entropy in bits per byte are not compressed if ZeDMD supports stored chunks.
+#define ZEDMD_COMM_INCOMPRESSIBLE_ENTROPY 7.5
+
+// SCHED_FIFO priority of a realtime thread and the nice value of a high priority thread.
+#define ZEDMD_COMM_THREAD_REALTIME_PRIORITY 10
+#define ZEDMD_COMM_THREAD_HIGH_PRIORITY_NICE -10
+
+// Maximum distance in pixels per frame that will be detected as scrolling.
+#define ZEDMD_COMM_SHIFT_MAX_DX 8
+#define ZEDMD_COMM_SHIFT_MAX_DY 4
+
+// Memory budget for compressed chunks kept for looping animations.
+#define ZEDMD_COMM_CHUNK_CACHE_SIZE_MAX (256 * 1024)
+
 // Typically, the MTU is 1480 (1500 - 20 byte header).
 // 1460 is safe. For UART or USB CDC we use the same limit since the ZeDMD firmware is unified.
 // For USB UART 128x32 send one row (16 zones).
 #define ZEDMD_ZONES_BYTE_LIMIT (128 * 4 * 2 + 16)
 
+// The largest zone is 16x8 pixels on a 256x64 panel.
+#define ZEDMD_ZONE_BYTES_MAX (16 * 8 * 2)
+
 typedef enum
 {
   FrameSize = 0x02,
@@ -61,10 +90,15 @@ typedef enum
   Reset = 0x1f,
   GetVersionBytes = 0x20,
   GetResolution = 0x21,
+  GetCapabilities = 0x40,
 
   AnnounceRGB565ZonesStream = 0x04,
   RGB565ZonesStream = 0x05,
   RenderRGB565Frame = 0x06,
+  RGB565EncodedZonesStream = 0x41,
+  // Number of regions followed by x, y, width, height (16 bit each) and dx, dy (signed 8 bit) per region. Pixels
+  // shifted into a region from outside are black. The zones of the next stream are based on the shifted content.
+  ShiftRegions = 0x42,
 
   ClearScreen = 0x0a,
 
@@ -72,10 +106,85 @@ typedef enum
   EnableDebug = 0x63,
 } ZEDMD_COMM_COMMAND;
 
+// Optional protocol extensions reported by the firmware in response to GetCapabilities.
+// Older firmware doesn't answer that command, so none of the extensions will be used.
+typedef enum
+{
+  XorDeltaZones = 0x01,
+  IndexedZones = 0x02,
+  SolidZones = 0x04,
+  StoredChunks = 0x08,
+  StreamingDeflate = 0x10,
+  RegionShifts = 0x20,
+} ZEDMD_COMM_CAPABILITY;
+
+// Zone encodings of a RGB565EncodedZonesStream. Like in RGB565ZonesStream, every zone starts with its index and a
+// black zone is sent as index + 128 without any payload. Otherwise, the index is followed by the encoding and its data.
+typedef enum
+{
+  ZoneRaw = 0x00,
+  ZoneXorDelta = 0x01,
+  // Number of colors (1-16), the RGB565 palette and the color indices packed into 1, 2 or 4 bits (MSB first).
+  ZoneIndexed = 0x02,
+  // A single RGB565 color for the entire zone.
+  ZoneSolid = 0x03,
+} ZEDMD_ZONE_ENCODING;
+
+// Buffers for the chunks of the queued frames, allocated upfront by ZeDMDComm::AllocateFrameQueue(). The thread
+// queueing the frames takes them and the run thread gives them back once a frame is sent. Together with the recycled
+// frames of ZeDMDFrameQueue, queueing a frame doesn't allocate.
+class ZeDMDChunkPool
+{
+ public:
+  ~ZeDMDChunkPool() { free(m_pBuffers); }
+
+  // Called before the run thread starts, while no frame holds a buffer. The pool only grows.
+  void Allocate(int count)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (count <= m_count) return;
+
+    free(m_pBuffers);
+    m_pBuffers = (uint8_t*)malloc(count * ZEDMD_ZONES_BYTE_LIMIT);
+    m_count = count;
+    m_free.clear();
+    m_free.reserve(count);
+    for (int i = 0; i < count; i++)
+    {
+      m_free.push_back(&m_pBuffers[i * ZEDMD_ZONES_BYTE_LIMIT]);
+    }
+  }
+
+  // Returns nullptr if all buffers are in use.
+  uint8_t* Acquire()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_free.empty()) return nullptr;
+
+    uint8_t* pBuffer = m_free.back();
+    m_free.pop_back();
+    return pBuffer;
+  }
+
+  void Release(uint8_t* pBuffer)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_free.push_back(pBuffer);
+  }
+
+ private:
+  uint8_t* m_pBuffers = nullptr;
+  int m_count = 0;
+  std::vector<uint8_t*> m_free;
+  std::mutex m_mutex;
+};
+
 struct ZeDMDFrameData
 {
   uint8_t* data;
   int size;
+  // The pool the data was taken from, nullptr if it is allocated on the heap.
+  ZeDMDChunkPool* pool = nullptr;
 
   // Default constructor
   ZeDMDFrameData(int sz = 0) : size(sz), data((sz > 0) ? new uint8_t[sz] : nullptr) {}
@@ -86,8 +195,24 @@ struct ZeDMDFrameData
     if (sz > 0) memcpy(data, d, sz);
   }
 
+  // Constructor to copy data into a buffer of the pool, the heap is only used if the pool is exhausted
+  ZeDMDFrameData(ZeDMDChunkPool* p, uint8_t* d, int sz)
+      : size(sz), data((sz > 0 && sz <= ZEDMD_ZONES_BYTE_LIMIT) ? p->Acquire() : nullptr)
+  {
+    if (data) pool = p;
+    else if (sz > 0) data = new uint8_t[sz];
+    if (sz > 0) memcpy(data, d, sz);
+  }
+
   // Destructor
-  ~ZeDMDFrameData() { delete[] data; }
+  ~ZeDMDFrameData() { Free(); }
+
+  void Free()
+  {
+    if (pool) pool->Release(data);
+    else delete[] data;
+    pool = nullptr;
+  }
 
   // Copy constructor (deep copy)
   ZeDMDFrameData(const ZeDMDFrameData& other)
@@ -101,7 +226,7 @@ struct ZeDMDFrameData
   {
     if (this != &other)
     {
-      delete[] data;  // Clean up existing resource
+      Free();  // Clean up existing resource
       size = other.size;
       data = (other.size > 0) ? new uint8_t[other.size] : nullptr;
       if (other.size > 0) memcpy(data, other.data, other.size);
@@ -110,10 +235,11 @@ struct ZeDMDFrameData
   }
 
   // Move constructor
-  ZeDMDFrameData(ZeDMDFrameData&& other) noexcept : size(other.size), data(other.data)
+  ZeDMDFrameData(ZeDMDFrameData&& other) noexcept : size(other.size), data(other.data), pool(other.pool)
   {
     other.size = 0;
     other.data = nullptr;
+    other.pool = nullptr;
   }
 
   // Move assignment operator
@@ -121,13 +247,15 @@ struct ZeDMDFrameData
   {
     if (this != &other)
     {
-      delete[] data;  // Clean up existing resource
+      Free();  // Clean up existing resource
 
       size = other.size;
       data = other.data;
+      pool = other.pool;
 
       other.size = 0;
       other.data = nullptr;
+      other.pool = nullptr;
     }
 
     return *this;
@@ -138,12 +266,16 @@ struct ZeDMDFrame
 {
   uint8_t command;
   std::vector<ZeDMDFrameData> data;
+  // Time of the submission, for the frame pacing and the latency.
+  std::chrono::steady_clock::time_point submitted;
+  // Tickets of the rendered frames that are displayed once this frame is acknowledged.
+  std::vector<uint32_t> tickets;
 
   // Constructor with just the command
-  ZeDMDFrame(uint8_t cmd) : command(cmd) {}
+  ZeDMDFrame(uint8_t cmd) : command(cmd), submitted(std::chrono::steady_clock::now()) {}
 
   // Constructor to add initial data
-  ZeDMDFrame(uint8_t cmd, uint8_t* d, int s) : command(cmd)
+  ZeDMDFrame(uint8_t cmd, uint8_t* d, int s) : command(cmd), submitted(std::chrono::steady_clock::now())
   {
     data.emplace_back(d, s);  // Create and move a new ZeDMDFrameData object
   }
@@ -156,7 +288,13 @@ struct ZeDMDFrame
   ZeDMDFrame& operator=(const ZeDMDFrame&) = delete;
 
   // Move constructor
-  ZeDMDFrame(ZeDMDFrame&& other) noexcept : command(other.command), data(std::move(other.data)) {}
+  ZeDMDFrame(ZeDMDFrame&& other) noexcept
+      : command(other.command),
+        data(std::move(other.data)),
+        submitted(other.submitted),
+        tickets(std::move(other.tickets))
+  {
+  }
 
   // Move assignment operator
   ZeDMDFrame& operator=(ZeDMDFrame&& other) noexcept
@@ -165,13 +303,109 @@ struct ZeDMDFrame
     {
       command = other.command;
       data = std::move(other.data);
+      submitted = other.submitted;
+      tickets = std::move(other.tickets);
     }
     return *this;
   }
+
+  // Starts a new frame, the vectors keep their capacity.
+  void Reset(uint8_t cmd)
+  {
+    command = cmd;
+    data.clear();
+    submitted = std::chrono::steady_clock::now();
+    tickets.clear();
+  }
+
+  // Takes over the content of the other frame. Unlike the move assignment, both frames keep the capacity of their
+  // vectors, so recycled frames don't allocate.
+  void Take(ZeDMDFrame& other)
+  {
+    command = other.command;
+    data.clear();
+    for (ZeDMDFrameData& frameData : other.data) data.push_back(std::move(frameData));
+    other.data.clear();
+    submitted = other.submitted;
+    tickets.assign(other.tickets.begin(), other.tickets.end());
+    other.tickets.clear();
+  }
+
+  void Reserve(int chunks, int numTickets)
+  {
+    data.reserve(chunks);
+    tickets.reserve(numTickets);
+  }
+};
+
+// The queued frames, a ring of recycled frames. Push() and Pop() copy the frames in and out, so queueing a frame
+// doesn't allocate as long as the ring and the chunks of its frames fit.
+class ZeDMDFrameQueue
+{
+ public:
+  void Allocate(size_t size, int chunks, int numTickets)
+  {
+    while (m_frames.size() < size) m_frames.emplace_back(0);
+    for (ZeDMDFrame& frame : m_frames) frame.Reserve(chunks, numTickets);
+  }
+
+  bool Empty() const { return 0 == m_count; }
+  size_t Size() const { return m_count; }
+  ZeDMDFrame& Front() { return m_frames[m_head]; }
+  ZeDMDFrame& Back() { return m_frames[(m_head + m_count - 1) % m_frames.size()]; }
+
+  void Push(ZeDMDFrame& frame)
+  {
+    if (m_count == m_frames.size())
+    {
+      // The ring is full, a new frame is inserted behind the last one.
+      m_frames.emplace(m_frames.begin() + m_head, 0);
+      m_head = (m_head + 1) % m_frames.size();
+    }
+    m_frames[(m_head + m_count) % m_frames.size()].Take(frame);
+    m_count++;
+  }
+
+  void Pop(ZeDMDFrame& frame)
+  {
+    frame.Take(Front());
+    Pop();
+  }
+
+  // Drops the first frame, which gives its chunks back to the pool.
+  void Pop()
+  {
+    Front().Reset(0);
+    m_head = (m_head + 1) % m_frames.size();
+    m_count--;
+  }
+
+ private:
+  std::vector<ZeDMDFrame> m_frames;
+  size_t m_head = 0;
+  size_t m_count = 0;
+};
+
+struct ZeDMDCompressedChunk
+{
+  uint64_t hash;
+  ZeDMDFrameData data;
+
+  ZeDMDCompressedChunk(uint64_t h, uint8_t* d, int sz) : hash(h), data(d, sz) {}
+};
+
+// The latest content of a zone that changed while ZeDMD is behind.
+struct ZeDMDDirtyZone
+{
+  bool dirty;
+  bool solid;
+  uint8_t data[ZEDMD_ZONE_BYTES_MAX];
 };
 
 typedef void(ZEDMDCALLBACK* ZeDMD_LogCallback)(const char* format, va_list args, const void* userData);
 
+struct mz_stream_s;
+
 class ZeDMDComm
 {
  public:
@@ -183,6 +417,7 @@ class ZeDMDComm
   ~ZeDMDComm();
 
   void SetLogCallback(ZeDMD_LogCallback callback, const void* userData);
+  void SetFrameCallback(ZeDMD_FrameCallback callback, const void* userData);
 
   void IgnoreDevice(const char* ignore_device);
   void SetDevice(const char* device);
@@ -191,40 +426,119 @@ class ZeDMDComm
   virtual void Disconnect();
   virtual bool IsConnected();
 
+  void AllocateFrameQueue();
   void Run();
   void QueueFrame(uint8_t* buffer, int size);
+  void QueueFrame(uint8_t* buffer, int size, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
   void QueueCommand(char command, uint8_t* buffer, int size);
   void QueueCommand(char command);
   void QueueCommand(char command, uint8_t value);
-  bool FillDelayed();
+  void BeginTicket(uint32_t ticket);
+  void EndTicket();
+  void SupersedeTicket(uint32_t ticket);
+  bool IsBehind();
+  bool AcceptFrame();
+  void SetSubmitPolicy(ZEDMD_SUBMIT_POLICY policy);
+  void SetThreadPriority(ZEDMD_THREAD_PRIORITY priority);
+  void SetThreadAffinity(uint32_t cpuMask);
+  void SetThreadName(const char* name);
   void SoftReset();
+  void SetStreamingCompression(bool enable);
+  void SetFramePacing(uint8_t fps, uint16_t latencyBudget);
 
   uint16_t const GetWidth();
   uint16_t const GetHeight();
   bool const IsS3();
+  uint32_t const GetChunkCacheHits();
+  uint32_t const GetChunkCacheMisses();
+  float const GetFps();
+  uint32_t const GetLatency();
+  uint8_t GetQueueDepth();
 
  protected:
   virtual bool StreamBytes(ZeDMDFrame* pFrame);
+  virtual bool SendZonesChunk(uint8_t command, uint8_t* pChunk, int chunkSize);
   virtual void Reset();
   void Log(const char* format, ...);
+  bool IsZonesStream(uint8_t command);
+  bool IsRepaintCommand(uint8_t command);
+  void StreamCommands();
+  void PaceFrame();
+  void UpdateFrameStats(std::chrono::steady_clock::time_point submitted);
+  void UpdateFps();
+  void ApplyThreadSettings();
+  void CompleteTickets(const std::vector<uint32_t>& tickets, ZEDMD_FRAME_STATUS status);
+  void CompleteTicket(uint32_t ticket, ZEDMD_FRAME_STATUS status);
+  void FailQueuedFrames();
+  bool IsBehind(size_t queued);
+  void ResetZones(uint8_t hash);
+  uint16_t AppendZone(uint8_t* pBuffer, uint8_t idx, const uint8_t* pZone, bool solid, bool deltaAllowed);
+  bool QueueDirtyZones();
+  void DiscardDirtyZones();
+  void SelectZonePipeline();
+  int EncodeChunk(uint8_t* pEncoded, int maxSize, uint8_t* pData, int size, bool* pStored);
+  int CompressChunk(uint8_t* pCompressed, int maxSize, uint8_t* pData, int size);
+  bool IsCompressible(const uint8_t* pData, int size);
+  int SplitChunk(uint8_t command, const uint8_t* pChunk, int chunkSize);
 
   uint16_t m_width = 128;
   uint16_t m_height = 32;
   bool m_s3 = false;
   bool m_cdc = false;
+  // The capabilities the frames are encoded for. They are owned by the thread queueing the frames and only changed
+  // while holding m_dirtyZonesMutex, since the run thread encodes the dirty zones.
+  uint8_t m_capabilities = 0;
   uint8_t m_zoneWidth = 8;
   uint8_t m_zoneHeight = 4;
   std::atomic<bool> m_stopFlag;
   std::atomic<bool> m_fullFrameFlag;
+  std::atomic<bool> m_resyncFlag;
+  // The capabilities reported by ZeDMD, the transport uses them directly.
+  std::atomic<uint8_t> m_deviceCapabilities;
+  std::atomic<bool> m_streamingCompression;
 
  private:
   bool Connect(char* pName);
   bool Handshake(char* pDevice);
+  bool SendHandshake(uint16_t* pWidth, uint16_t* pHeight);
+  void Reconnect();
+  uint8_t QueryCapabilities();
   bool SendChunks(uint8_t* pData, uint16_t size);
+  bool SendStreamedZonesChunk(uint8_t command, uint8_t* pChunk, int chunkSize, mz_stream_s* pStream, bool* pContinued);
+  uint16_t EncodeXorDelta(uint8_t* pDelta, const uint8_t* pZone, const uint8_t* pPrevious, uint16_t zoneBytes);
+  uint16_t EncodeIndexed(uint8_t* pData, const uint8_t* pZone, uint16_t zoneBytes);
+  template <uint16_t width = 0, uint8_t zoneWidth = 0, uint8_t zoneHeight = 0>
+  bool ExtractZone(const uint8_t* pFrame, uint16_t x, uint16_t y, uint8_t* pZone);
+  template <uint8_t zoneWidth = 0, uint8_t zoneHeight = 0>
+  uint64_t HashZone(const uint8_t* pZone, bool solid);
+  template <uint16_t width, uint16_t height>
+  void HashZones(const uint8_t* pFrame, uint8_t left, uint8_t top, uint8_t right, uint8_t bottom);
+  uint16_t DetectShifts(const uint8_t* pFrame, uint8_t* pRegions);
+  uint32_t CountShiftMismatches(const uint16_t* pFrame, uint16_t y, uint16_t height, int8_t dx, int8_t dy);
+  void ShiftRegion(uint16_t y, uint16_t height, int8_t dx, int8_t dy);
 
   ZeDMD_LogCallback m_logCallback = nullptr;
   const void* m_logUserData = nullptr;
+  ZeDMD_FrameCallback m_frameCallback = nullptr;
+  const void* m_frameUserData = nullptr;
+  // Ticket of the frame that is currently rendered, 0 if none.
+  uint32_t m_ticket = 0;
+  ZEDMD_SUBMIT_POLICY m_submitPolicy = ZEDMD_POLICY_LATEST_WINS;
+  // Applied by the threads themselves, since some platforms only support changing the calling thread.
+  ZEDMD_THREAD_PRIORITY m_threadPriority = ZEDMD_PRIORITY_NORMAL;
+  uint32_t m_threadAffinity = 0;
+  char m_threadName[16] = "ZeDMD";
+  std::mutex m_threadSettingsMutex;
+  std::atomic<bool> m_threadSettingsChanged;
   uint64_t m_zoneHashes[128] = {0};
+  uint8_t m_zoneContents[128][ZEDMD_ZONE_BYTES_MAX] = {0};
+  bool m_zoneContentsValid = false;
+  bool m_zoneHashesValid = false;
+  uint8_t m_previousFrame[256 * 64 * 2] = {0};
+  uint8_t m_zoneScratch[ZEDMD_ZONE_BYTES_MAX];
+  uint8_t m_zonesScratch[ZEDMD_ZONES_BYTE_LIMIT];
+  uint64_t m_frameZoneHashes[128] = {0};
+  void (ZeDMDComm::*m_pHashZones)(const uint8_t* pFrame, uint8_t left, uint8_t top, uint8_t right, uint8_t bottom);
   const uint8_t m_allBlack[32768] = {0};
 
   char m_ignoredDevices[10][32] = {0};
@@ -237,10 +551,45 @@ class ZeDMDComm
   struct sp_port* m_pSerialPort;
   struct sp_port_config* m_pSerialPortConfig;
 #endif
-  std::queue<ZeDMDFrame> m_frames;
+  // Declared before the frames, which give their chunks back when they are destroyed.
+  ZeDMDChunkPool m_chunkPool;
+  ZeDMDFrameQueue m_frames;
+  // The frames built by the thread queueing them and the ones of the run thread, recycled like the queued frames.
+  ZeDMDFrame m_queuedFrame{0};
+  ZeDMDFrame m_shiftFrame{0};
+  ZeDMDFrame m_streamedFrame{0};
+  ZeDMDFrame m_dirtyFrame{0};
   std::thread* m_pThread;
   std::mutex m_frameQueueMutex;
-  ZeDMDFrame m_delayedFrame = {0};
-  std::mutex m_delayedFrameMutex;
-  bool m_delayedFrameReady = false;
+  // Signalled whenever frames or dirty zones leave the queue, for a caller blocked in AcceptFrame().
+  std::condition_variable m_frameQueueCondition;
+  // The frame taken from the queue by the run thread and the tickets completed by it, guarded by m_frameQueueMutex.
+  bool m_streamingFrame = false;
+  std::vector<uint32_t> m_streamingTickets;
+  std::vector<uint32_t> m_completedTickets;
+  std::queue<ZeDMDFrame> m_commands;
+  std::mutex m_commandQueueMutex;
+  ZeDMDDirtyZone m_dirtyZones[128] = {};
+  uint8_t m_numDirtyZones = 0;
+  std::chrono::steady_clock::time_point m_dirtySubmitted;
+  std::vector<uint32_t> m_dirtyTickets;
+  // Tickets of the thread queueing the frames that got superseded by the current one.
+  std::vector<uint32_t> m_supersededTickets;
+  std::mutex m_dirtyZonesMutex;
+  uint8_t m_dirtyZonesScratch[ZEDMD_ZONES_BYTE_LIMIT];
+  // The run thread frames every chunk it sends in here, so streaming a frame doesn't allocate.
+  uint8_t m_chunkScratch[CTRL_CHARS_HEADER_SIZE + 3 + ZEDMD_ZONES_BYTE_LIMIT];
+  std::list<ZeDMDCompressedChunk> m_chunkCache;
+  std::unordered_map<uint64_t, std::list<ZeDMDCompressedChunk>::iterator> m_chunkCacheIndex;
+  int m_chunkCacheSize = 0;
+  std::atomic<uint32_t> m_chunkCacheHits;
+  std::atomic<uint32_t> m_chunkCacheMisses;
+  // Frame pacing in microseconds, 0 if disabled.
+  std::atomic<uint32_t> m_frameInterval;
+  std::atomic<uint32_t> m_latencyBudget;
+  std::chrono::steady_clock::time_point m_lastFrameSlot;
+  std::chrono::steady_clock::time_point m_statsStart;
+  uint32_t m_statsFrames = 0;
+  std::atomic<float> m_fps;
+  std::atomic<uint32_t> m_latency;
 };
@@ -0,0 +1,167 @@
+#include "ZeDMDPipeline.h"
+
+ZeDMDPipeline::ZeDMDPipeline(std::function<void(ZeDMDRenderJob*)> encode, uint32_t bufferSize) : m_encode(encode)
+{
+  // All buffers are allocated upfront, so handing off a frame doesn't need to allocate.
+  for (uint8_t i = 0; i < ZEDMD_PIPELINE_QUEUE_SIZE_MAX; i++)
+  {
+    m_jobs[i].pBuffer = (uint8_t*)malloc(bufferSize);
+  }
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    m_slots[i].pBuffer = (uint8_t*)malloc(bufferSize);
+  }
+  m_ready.store(2, std::memory_order_release);
+
+  m_pThread = new std::thread([this]() { Run(); });
+}
+
+ZeDMDPipeline::~ZeDMDPipeline()
+{
+  // The queued jobs are encoded before the thread finishes.
+  m_mutex.lock();
+  m_stop = true;
+  m_mutex.unlock();
+  m_condition.notify_all();
+
+  m_pThread->join();
+  delete m_pThread;
+
+  for (uint8_t i = 0; i < ZEDMD_PIPELINE_QUEUE_SIZE_MAX; i++)
+  {
+    free(m_jobs[i].pBuffer);
+  }
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    free(m_slots[i].pBuffer);
+  }
+}
+
+void ZeDMDPipeline::Run()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true)
+  {
+    m_condition.wait(lock,
+                     [this]()
+                     {
+                       return m_stop || m_count > 0 ||
+                              (m_ready.load(std::memory_order_acquire) & ZEDMD_PIPELINE_MAILBOX_NEW);
+                     });
+
+    if (0 == m_count)
+    {
+      if (m_ready.load(std::memory_order_acquire) & ZEDMD_PIPELINE_MAILBOX_NEW)
+      {
+        // Take the latest published frame and leave the previous front slot for the producer.
+        m_front = m_ready.exchange(m_front, std::memory_order_acq_rel) & ~ZEDMD_PIPELINE_MAILBOX_NEW;
+        m_mailboxBusy = true;
+        lock.unlock();
+        m_encode(&m_slots[m_front]);
+        lock.lock();
+        m_mailboxBusy = false;
+        m_condition.notify_all();
+
+        continue;
+      }
+
+      return;
+    }
+
+    // The producer never touches a queued job except the newest one, which is never the one at m_head if the queue
+    // is full. So the job could be encoded without holding the lock.
+    ZeDMDRenderJob* pJob = &m_jobs[m_head];
+    lock.unlock();
+    m_encode(pJob);
+    lock.lock();
+
+    m_head = (m_head + 1) % ZEDMD_PIPELINE_QUEUE_SIZE_MAX;
+    m_count--;
+    m_condition.notify_all();
+  }
+}
+
+ZeDMDRenderJob* ZeDMDPipeline::AcquireJob(ZEDMD_SUBMIT_POLICY policy, bool region, uint32_t* pSuperseded)
+{
+  *pSuperseded = 0;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (ZEDMD_PIPELINE_QUEUE_SIZE_MAX == m_count)
+  {
+    // A region only patches the frame, so neither could it be dropped nor could it replace the newest job, which
+    // might be the frame it patches. Only a complete frame covers all pixels of the job it replaces.
+    switch (region ? ZEDMD_POLICY_BLOCK : policy)
+    {
+      case ZEDMD_POLICY_BLOCK:
+        m_condition.wait(lock, [this]() { return m_count < ZEDMD_PIPELINE_QUEUE_SIZE_MAX; });
+        break;
+
+      case ZEDMD_POLICY_FAIL_FAST:
+        return nullptr;
+
+      default:
+        // The newest job is replaced, it hasn't been started yet.
+        m_count--;
+        *pSuperseded = m_jobs[(m_head + m_count) % ZEDMD_PIPELINE_QUEUE_SIZE_MAX].ticket;
+        break;
+    }
+  }
+
+  // The job behind the queued ones is filled without holding the lock. The encode thread only advances m_head and
+  // decreases m_count, so SubmitJob() appends this very job.
+  return &m_jobs[(m_head + m_count) % ZEDMD_PIPELINE_QUEUE_SIZE_MAX];
+}
+
+void ZeDMDPipeline::SubmitJob()
+{
+  m_mutex.lock();
+  m_count++;
+  m_mutex.unlock();
+  m_condition.notify_all();
+}
+
+void ZeDMDPipeline::Flush()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_condition.wait(lock,
+                   [this]()
+                   {
+                     return 0 == m_count && !m_mailboxBusy &&
+                            !(m_ready.load(std::memory_order_acquire) & ZEDMD_PIPELINE_MAILBOX_NEW);
+                   });
+}
+
+bool ZeDMDPipeline::IsFull()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return ZEDMD_PIPELINE_QUEUE_SIZE_MAX == m_count;
+}
+
+uint8_t ZeDMDPipeline::GetQueueDepth()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_count + ((m_ready.load(std::memory_order_acquire) & ZEDMD_PIPELINE_MAILBOX_NEW) ? 1 : 0);
+}
+
+uint8_t* ZeDMDPipeline::AcquireBackBuffer() { return m_slots[m_back].pBuffer; }
+
+uint32_t ZeDMDPipeline::PublishBackBuffer(const ZeDMDRenderJob* pJob)
+{
+  ZeDMDRenderJob& slot = m_slots[m_back];
+  uint8_t* pBuffer = slot.pBuffer;
+  slot = *pJob;
+  slot.pBuffer = pBuffer;
+  slot.pData = pBuffer;
+
+  // The back buffer becomes the ready one. If the previous ready frame wasn't picked up, it is superseded.
+  const uint8_t previous = m_ready.exchange(m_back | ZEDMD_PIPELINE_MAILBOX_NEW, std::memory_order_acq_rel);
+  m_back = previous & ~ZEDMD_PIPELINE_MAILBOX_NEW;
+  const uint32_t superseded = (previous & ZEDMD_PIPELINE_MAILBOX_NEW) ? m_slots[m_back].ticket : 0;
+
+  // The lock is never held while encoding. Taking it once ensures the encode thread doesn't miss the notification.
+  m_mutex.lock();
+  m_mutex.unlock();
+  m_condition.notify_all();
+
+  return superseded;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "ZeDMD.h"
+
+// Frames handed off to the encode stage, including the one that is currently encoded.
+#define ZEDMD_PIPELINE_QUEUE_SIZE_MAX 2
+
+// Set in the ready slot of the mailbox if it holds a frame that hasn't been picked up yet.
+#define ZEDMD_PIPELINE_MAILBOX_NEW 0x80
+
+// A frame or a region to be rendered, either passed directly or queued in the pipeline.
+struct ZeDMDRenderJob
+{
+  const uint8_t* pData = nullptr;
+  uint32_t pitch = 0;
+  ZEDMD_FRAME_FORMAT format = ZEDMD_FORMAT_RGB888;
+  // The palette the indices are looked up in, nullptr to keep the current one.
+  const uint16_t* pPaletteLut = nullptr;
+  uint32_t ticket = 0;
+  bool region = false;
+  uint16_t x = 0;
+  uint16_t y = 0;
+  uint16_t width = 0;
+  uint16_t height = 0;
+  // Storage of a queued job, the caller's frame is copied into it. It might be exchanged with the frame buffer.
+  uint8_t* pBuffer = nullptr;
+};
+
+// Runs the CPU work of rendering on its own thread. The queue is bounded, a full queue is handled according to the
+// submission policy. Jobs must be submitted by a single thread.
+// Additionally, a triple buffered mailbox lets the producer render into a back buffer and publish it without copying or
+// waiting. The encode thread always picks up the latest published frame, after the queued jobs.
+class ZeDMDPipeline
+{
+ public:
+  ZeDMDPipeline(std::function<void(ZeDMDRenderJob*)> encode, uint32_t bufferSize);
+  ~ZeDMDPipeline();
+
+  ZeDMDRenderJob* AcquireJob(ZEDMD_SUBMIT_POLICY policy, bool region, uint32_t* pSuperseded);
+  void SubmitJob();
+  void Flush();
+  bool IsFull();
+  uint8_t GetQueueDepth();
+  uint8_t* AcquireBackBuffer();
+  uint32_t PublishBackBuffer(const ZeDMDRenderJob* pJob);
+
+ private:
+  void Run();
+
+  std::function<void(ZeDMDRenderJob*)> m_encode;
+  ZeDMDRenderJob m_jobs[ZEDMD_PIPELINE_QUEUE_SIZE_MAX];
+  // The queued jobs are m_head to m_head + m_count - 1, the job at m_head stays queued while it is encoded.
+  uint8_t m_head = 0;
+  uint8_t m_count = 0;
+  // Mailbox slots owned by the producer and by the encode thread, the third one is exchanged atomically between both.
+  ZeDMDRenderJob m_slots[3];
+  uint8_t m_back = 0;
+  uint8_t m_front = 1;
+  std::atomic<uint8_t> m_ready;
+  bool m_mailboxBusy = false;
+  bool m_stop = false;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::thread* m_pThread;
+};
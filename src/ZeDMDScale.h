@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+// The SIMD paths could be disabled by defining ZEDMD_NO_SIMD, which builds the scalar code only.
+#if defined(ZEDMD_NO_SIMD)
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ZEDMD_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define ZEDMD_NEON
+#endif
+
+// A RGB888 pixel, only compared and copied by the 2x scalers.
+struct Rgb888Pixel
+{
+  uint8_t rgb[3];
+
+  bool operator==(const Rgb888Pixel& other) const
+  {
+    return rgb[0] == other.rgb[0] && rgb[1] == other.rgb[1] && rgb[2] == other.rgb[2];
+  }
+};
+
+// Picks a if it is repeated within the 2x2 block, otherwise the first repeated one of b, c or d.
+template <typename T>
+static inline T PickDominant(T a, T b, T c, T d)
+{
+  if (a == b || a == c || a == d) return a;
+  if (b == c || b == d) return b;
+  if (c == d) return c;
+  return a;
+}
+
+#if defined(ZEDMD_SSE2)
+static inline __m128i Select16(__m128i mask, __m128i a, __m128i b)
+{
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static inline __m128i PickDominant16(__m128i a, __m128i b, __m128i c, __m128i d)
+{
+  __m128i pickA = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi16(a, b), _mm_cmpeq_epi16(a, c)), _mm_cmpeq_epi16(a, d));
+  __m128i pickB = _mm_or_si128(_mm_cmpeq_epi16(b, c), _mm_cmpeq_epi16(b, d));
+  __m128i pickC = _mm_cmpeq_epi16(c, d);
+  return Select16(pickA, a, Select16(pickB, b, Select16(pickC, c, a)));
+}
+
+// Splits 16 pixels into the 8 pixels at even and the 8 pixels at odd positions.
+static inline void Deinterleave16(const uint16_t* pSrc, __m128i* pEven, __m128i* pOdd)
+{
+  __m128i low = _mm_loadu_si128((const __m128i*)pSrc);
+  __m128i high = _mm_loadu_si128((const __m128i*)(pSrc + 8));
+  *pEven = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(low, 16), 16), _mm_srai_epi32(_mm_slli_epi32(high, 16), 16));
+  *pOdd = _mm_packs_epi32(_mm_srai_epi32(low, 16), _mm_srai_epi32(high, 16));
+}
+#elif defined(ZEDMD_NEON)
+static inline uint16x8_t PickDominant16(uint16x8_t a, uint16x8_t b, uint16x8_t c, uint16x8_t d)
+{
+  uint16x8_t pickA = vorrq_u16(vorrq_u16(vceqq_u16(a, b), vceqq_u16(a, c)), vceqq_u16(a, d));
+  uint16x8_t pickB = vorrq_u16(vceqq_u16(b, c), vceqq_u16(b, d));
+  uint16x8_t pickC = vceqq_u16(c, d);
+  return vbslq_u16(pickA, a, vbslq_u16(pickB, b, vbslq_u16(pickC, c, a)));
+}
+#endif
+
+// Halves a row of 2x2 blocks, the block corner of the frame's quadrant is preferred, like FrameUtil's ScaleDown().
+template <typename T>
+static void ScaleDownRow(T* pDest, const T* pUpper, const T* pLower, uint16_t from, uint16_t to, bool left, bool top)
+{
+  uint16_t x = from;
+
+  if constexpr (std::is_same_v<T, uint16_t>)
+  {
+#if defined(ZEDMD_SSE2)
+    for (; x + 8 <= to; x += 8)
+    {
+      __m128i ul, ur, ll, lr;
+      Deinterleave16(&pUpper[x * 2], &ul, &ur);
+      Deinterleave16(&pLower[x * 2], &ll, &lr);
+      __m128i result = top ? (left ? PickDominant16(ul, ur, ll, lr) : PickDominant16(ur, ul, lr, ll))
+                           : (left ? PickDominant16(ll, lr, ul, ur) : PickDominant16(lr, ll, ur, ul));
+      _mm_storeu_si128((__m128i*)&pDest[x], result);
+    }
+#elif defined(ZEDMD_NEON)
+    for (; x + 8 <= to; x += 8)
+    {
+      uint16x8x2_t upper = vld2q_u16(&pUpper[x * 2]);
+      uint16x8x2_t lower = vld2q_u16(&pLower[x * 2]);
+      uint16x8_t ul = upper.val[0], ur = upper.val[1], ll = lower.val[0], lr = lower.val[1];
+      uint16x8_t result = top ? (left ? PickDominant16(ul, ur, ll, lr) : PickDominant16(ur, ul, lr, ll))
+                              : (left ? PickDominant16(ll, lr, ul, ur) : PickDominant16(lr, ll, ur, ul));
+      vst1q_u16(&pDest[x], result);
+    }
+#endif
+  }
+
+  for (; x < to; x++)
+  {
+    T ul = pUpper[x * 2], ur = pUpper[x * 2 + 1], ll = pLower[x * 2], lr = pLower[x * 2 + 1];
+    pDest[x] = top ? (left ? PickDominant(ul, ur, ll, lr) : PickDominant(ur, ul, lr, ll))
+                   : (left ? PickDominant(ll, lr, ul, ur) : PickDominant(lr, ll, ur, ul));
+  }
+}
+
+// Only the pixels within left <= x < right and top <= y < bottom of the halved frame are written.
+template <typename T>
+static void ScaleDown2x(T* pDest, const T* pSrc, uint16_t srcWidth, uint16_t srcHeight, uint16_t left, uint16_t top,
+                        uint16_t right, uint16_t bottom)
+{
+  const uint16_t destWidth = srcWidth / 2;
+  // The source pixel x < srcWidth / 2 belongs to the left half, y < srcHeight / 2 to the upper half.
+  const uint16_t leftWidth = (srcWidth / 2 + 1) / 2;
+  const uint16_t topHeight = (srcHeight / 2 + 1) / 2;
+
+  for (uint16_t y = top; y < bottom; y++)
+  {
+    const T* pUpper = &pSrc[y * 2 * srcWidth];
+    const T* pLower = pUpper + srcWidth;
+    ScaleDownRow(&pDest[y * destWidth], pUpper, pLower, left, std::min(leftWidth, right), true, y < topHeight);
+    ScaleDownRow(&pDest[y * destWidth], pUpper, pLower, std::max(leftWidth, left), right, false, y < topHeight);
+  }
+}
+
+template <typename T>
+static void ScaleDown2x(T* pDest, const T* pSrc, uint16_t srcWidth, uint16_t srcHeight)
+{
+  ScaleDown2x(pDest, pSrc, srcWidth, srcHeight, 0, 0, srcWidth / 2, srcHeight / 2);
+}
+
+// Doubles a row using scale2x, http://www.scale2x.it/algorithm, with the borders of the frame repeated.
+template <typename T>
+static void ScaleUpRow(T* pTop, T* pBottom, const T* pAbove, const T* pRow, const T* pBelow, uint16_t width,
+                       uint16_t from, uint16_t to)
+{
+  auto scalePixel = [&](uint16_t x)
+  {
+    T b = pAbove[x], h = pBelow[x], e = pRow[x];
+    T d = pRow[x > 0 ? x - 1 : x], f = pRow[x < width - 1 ? x + 1 : x];
+    bool edge = !(b == h) && !(d == f);
+    pTop[x * 2] = (edge && d == b) ? d : e;
+    pTop[x * 2 + 1] = (edge && b == f) ? f : e;
+    pBottom[x * 2] = (edge && d == h) ? d : e;
+    pBottom[x * 2 + 1] = (edge && h == f) ? f : e;
+  };
+
+  uint16_t x = from;
+  // The vector loops read the left neighbor, which the first pixel of the row doesn't have.
+  if (0 == x && x < to) scalePixel(x++);
+
+  if constexpr (std::is_same_v<T, uint16_t>)
+  {
+#if defined(ZEDMD_SSE2)
+    for (; x + 8 <= to && x + 9 <= width; x += 8)
+    {
+      __m128i b = _mm_loadu_si128((const __m128i*)&pAbove[x]);
+      __m128i h = _mm_loadu_si128((const __m128i*)&pBelow[x]);
+      __m128i d = _mm_loadu_si128((const __m128i*)&pRow[x - 1]);
+      __m128i e = _mm_loadu_si128((const __m128i*)&pRow[x]);
+      __m128i f = _mm_loadu_si128((const __m128i*)&pRow[x + 1]);
+      __m128i edge = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi16(b, h), _mm_cmpeq_epi16(d, f)), _mm_set1_epi16(-1));
+      __m128i e0 = Select16(_mm_and_si128(edge, _mm_cmpeq_epi16(d, b)), d, e);
+      __m128i e1 = Select16(_mm_and_si128(edge, _mm_cmpeq_epi16(b, f)), f, e);
+      __m128i e2 = Select16(_mm_and_si128(edge, _mm_cmpeq_epi16(d, h)), d, e);
+      __m128i e3 = Select16(_mm_and_si128(edge, _mm_cmpeq_epi16(h, f)), f, e);
+      _mm_storeu_si128((__m128i*)&pTop[x * 2], _mm_unpacklo_epi16(e0, e1));
+      _mm_storeu_si128((__m128i*)&pTop[x * 2 + 8], _mm_unpackhi_epi16(e0, e1));
+      _mm_storeu_si128((__m128i*)&pBottom[x * 2], _mm_unpacklo_epi16(e2, e3));
+      _mm_storeu_si128((__m128i*)&pBottom[x * 2 + 8], _mm_unpackhi_epi16(e2, e3));
+    }
+#elif defined(ZEDMD_NEON)
+    for (; x + 8 <= to && x + 9 <= width; x += 8)
+    {
+      uint16x8_t b = vld1q_u16(&pAbove[x]);
+      uint16x8_t h = vld1q_u16(&pBelow[x]);
+      uint16x8_t d = vld1q_u16(&pRow[x - 1]);
+      uint16x8_t e = vld1q_u16(&pRow[x]);
+      uint16x8_t f = vld1q_u16(&pRow[x + 1]);
+      uint16x8_t edge = vmvnq_u16(vorrq_u16(vceqq_u16(b, h), vceqq_u16(d, f)));
+      uint16x8x2_t top, bottom;
+      top.val[0] = vbslq_u16(vandq_u16(edge, vceqq_u16(d, b)), d, e);
+      top.val[1] = vbslq_u16(vandq_u16(edge, vceqq_u16(b, f)), f, e);
+      bottom.val[0] = vbslq_u16(vandq_u16(edge, vceqq_u16(d, h)), d, e);
+      bottom.val[1] = vbslq_u16(vandq_u16(edge, vceqq_u16(h, f)), f, e);
+      vst2q_u16(&pTop[x * 2], top);
+      vst2q_u16(&pBottom[x * 2], bottom);
+    }
+#endif
+  }
+
+  for (; x < to; x++)
+  {
+    scalePixel(x);
+  }
+}
+
+// Only the 2x2 blocks overlapping left <= x < right and top <= y < bottom of the doubled frame are written.
+template <typename T>
+static void ScaleUp2x(T* pDest, const T* pSrc, uint16_t srcWidth, uint16_t srcHeight, uint16_t left, uint16_t top,
+                      uint16_t right, uint16_t bottom)
+{
+  const uint16_t destWidth = srcWidth * 2;
+
+  for (uint16_t y = top / 2; y < (bottom + 1) / 2; y++)
+  {
+    const T* pRow = &pSrc[y * srcWidth];
+    const T* pAbove = (y > 0) ? pRow - srcWidth : pRow;
+    const T* pBelow = (y < srcHeight - 1) ? pRow + srcWidth : pRow;
+    T* pTop = &pDest[y * 2 * destWidth];
+    ScaleUpRow(pTop, pTop + destWidth, pAbove, pRow, pBelow, srcWidth, left / 2, (right + 1) / 2);
+  }
+}
+
+template <typename T>
+static void ScaleUp2x(T* pDest, const T* pSrc, uint16_t srcWidth, uint16_t srcHeight)
+{
+  ScaleUp2x(pDest, pSrc, srcWidth, srcHeight, 0, 0, srcWidth * 2, srcHeight * 2);
+}
+
+// The rectangle is given in pixels of the scaled frame.
+template <typename T>
+static void Scale2x(uint8_t mode, uint8_t* pDest, const uint8_t* pSrc, uint16_t srcWidth, uint16_t srcHeight,
+                    uint16_t left, uint16_t top, uint16_t right, uint16_t bottom)
+{
+  if (1 == mode)
+  {
+    ScaleDown2x((T*)pDest, (const T*)pSrc, srcWidth, srcHeight, left, top, right, bottom);
+  }
+  else
+  {
+    ScaleUp2x((T*)pDest, (const T*)pSrc, srcWidth, srcHeight, left, top, right, bottom);
+  }
+}
@@ -76,9 +76,16 @@ bool ZeDMDWiFi::DoConnect(const char* ip, int port)
   if (SendGetRequest("/get_width")) m_width = (uint16_t)ReceiveIntegerPayload();
   if (SendGetRequest("/get_height")) m_height = (uint16_t)ReceiveIntegerPayload();
   if (SendGetRequest("/get_s3")) m_s3 = (ReceiveIntegerPayload() == 1);
+  // Older firmware doesn't provide the capabilities, ReceiveIntegerPayload() returns 0 in that case.
+  if (SendGetRequest("/get_capabilities")) m_capabilities = (uint8_t)ReceiveIntegerPayload();
+  // UDP datagrams get lost without notice. An XOR delta applied to a zone that missed its previous update would keep
+  // it corrupted, and so would a lost shift, so the zones are always sent with their full contents.
+  m_capabilities &= ~(ZEDMD_COMM_CAPABILITY::XorDeltaZones | ZEDMD_COMM_CAPABILITY::RegionShifts);
+  m_deviceCapabilities.store(m_capabilities, std::memory_order_release);
 
   m_zoneWidth = m_width / 16;
   m_zoneHeight = m_height / 8;
+  SelectZonePipeline();
 
   return true;
 }
@@ -235,6 +242,37 @@ bool ZeDMDWiFi::IsConnected() { return m_connected; }
 
 void ZeDMDWiFi::Reset() {}
 
+bool ZeDMDWiFi::SendZonesChunk(uint8_t command, uint8_t* pChunk, int chunkSize)
+{
+  // The chunk is split only after the scratch buffer isn't needed anymore, so the halves could reuse it.
+  uint8_t* pData = m_packetScratch;
+  bool stored = false;
+  int encodedSize = EncodeChunk(pData + 1, ZEDMD_ZONES_BYTE_LIMIT, pChunk, chunkSize, &stored);
+
+  if (0 == encodedSize)
+  {
+    // Without stored chunks, split a chunk that doesn't compress well enough instead of dropping the frame.
+    int split = SplitChunk(command, pChunk, chunkSize);
+    if (split > 0)
+    {
+      return SendZonesChunk(command, pChunk, split) && SendZonesChunk(command, pChunk + split, chunkSize - split);
+    }
+
+    Log("ZeDMD Wifi compression error");
+    return false;
+  }
+
+  pData[0] = stored ? (command | ZEDMD_COMM_STORED_CHUNK) : command;
+
+#if defined(_WIN32) || defined(_WIN64)
+  sendto(m_udpSocket, (const char*)pData, encodedSize + 1, 0, (struct sockaddr*)&m_udpServer, sizeof(m_udpServer));
+#else
+  sendto(m_udpSocket, pData, encodedSize + 1, 0, (struct sockaddr*)&m_udpServer, sizeof(m_udpServer));
+#endif
+
+  return true;
+}
+
 bool ZeDMDWiFi::StreamBytes(ZeDMDFrame* pFrame)
 {
   // An UDP package should not exceed the MTU (WiFi rx_buffer in ESP32 is 1460
@@ -245,9 +283,9 @@ bool ZeDMDWiFi::StreamBytes(ZeDMDFrame* pFrame)
 
   for (auto it = pFrame->data.rbegin(); it != pFrame->data.rend(); ++it)
   {
-    ZeDMDFrameData frameData = *it;
+    const ZeDMDFrameData& frameData = *it;
 
-    if (pFrame->command != ZEDMD_COMM_COMMAND::RGB565ZonesStream)
+    if (!IsZonesStream(pFrame->command))
     {
       size = 1 + frameData.size;
       pData = (uint8_t*)malloc(size);
@@ -266,52 +304,18 @@ bool ZeDMDWiFi::StreamBytes(ZeDMDFrame* pFrame)
     }
     else
     {
-      pData = (uint8_t*)malloc(ZEDMD_WIFI_MTU);
-      pData[0] = pFrame->command;
-
-      mz_ulong compressedSize = mz_compressBound(ZEDMD_ZONES_BYTE_LIMIT);
-      int status = mz_compress(pData + 1, &compressedSize, frameData.data, frameData.size);
-
-      if (compressedSize > (ZEDMD_WIFI_MTU - 1))
-      {
-        Log("ZeDMD Wifi error, compressed size of %d exceeds the MTU payload of %d", compressedSize, ZEDMD_WIFI_MTU);
-        free(pData);
-        return false;
-      }
-
-      if (compressedSize > ZEDMD_ZONES_BYTE_LIMIT)
-      {
-        Log("ZeDMD Wifi error, compressed size of %d exceeds the ZEDMD_ZONES_BYTE_LIMIT of %d", compressedSize,
-            ZEDMD_ZONES_BYTE_LIMIT);
-        free(pData);
-        return false;
-      }
+      if (!SendZonesChunk(pFrame->command, frameData.data, frameData.size)) return false;
 
-      if (status == MZ_OK)
-      {
-#if defined(_WIN32) || defined(_WIN64)
-        sendto(m_udpSocket, (const char*)pData, compressedSize + 1, 0, (struct sockaddr*)&m_udpServer,
-               sizeof(m_udpServer));
-#else
-        sendto(m_udpSocket, pData, compressedSize + 1, 0, (struct sockaddr*)&m_udpServer, sizeof(m_udpServer));
-#endif
-        continue;
-      }
-      else
-      {
-        Log("ZeDMD Wifi compression error");
-        free(pData);
-        return false;
-      }
+      continue;
     }
 
     free(pData);
   }
 
-  if (m_s3 && pFrame->command == ZEDMD_COMM_COMMAND::RGB565ZonesStream)
+  if (m_s3 && IsZonesStream(pFrame->command))
   {
     size = 1;
-    pData = (uint8_t*)malloc(size);
+    pData = m_packetScratch;
     pData[0] = ZEDMD_COMM_COMMAND::RenderRGB565Frame;
 
 #if defined(_WIN32) || defined(_WIN64)
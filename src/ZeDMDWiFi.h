@@ -29,6 +29,7 @@ class ZeDMDWiFi : public ZeDMDComm
  protected:
   bool DoConnect(const char* ip, int port);
   virtual bool StreamBytes(ZeDMDFrame* pFrame);
+  virtual bool SendZonesChunk(uint8_t command, uint8_t* pChunk, int chunkSize);
   virtual void Reset();
   bool openTcpConnection();
   bool SendGetRequest(const std::string& path);
@@ -43,4 +44,6 @@ class ZeDMDWiFi : public ZeDMDComm
   struct sockaddr_in m_tcpServer;
   bool m_connected = false;
   bool m_wsaStarted = false;
+  // The run thread assembles every package it sends in here, so streaming a frame doesn't allocate.
+  uint8_t m_packetScratch[ZEDMD_WIFI_MTU];
 };
@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cstring>
+#include <new>
+
+#include "ZeDMD.h"
+
+// Counts the heap allocations of the render calls. Only the allocations of the thread calling ZeDMD are tracked, the
+// run thread allocates the compressed chunks it sends.
+static thread_local bool s_tracking = false;
+static thread_local uint32_t s_allocations = 0;
+
+#if defined(__GLIBC__)
+// The allocations of the C runtime, miniz and std::malloc are counted, too.
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t num, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+extern "C" void __libc_free(void* ptr);
+
+static void* Allocate(size_t size)
+{
+  if (s_tracking) s_allocations++;
+  return __libc_malloc(size);
+}
+
+static void Deallocate(void* ptr) { __libc_free(ptr); }
+
+extern "C" void* malloc(size_t size) { return Allocate(size); }
+
+extern "C" void* calloc(size_t num, size_t size)
+{
+  if (s_tracking) s_allocations++;
+  return __libc_calloc(num, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+  if (s_tracking) s_allocations++;
+  return __libc_realloc(ptr, size);
+}
+#else
+static void* Allocate(size_t size)
+{
+  if (s_tracking) s_allocations++;
+  return malloc(size);
+}
+
+static void Deallocate(void* ptr) { free(ptr); }
+#endif
+
+// The replaced new and delete use the same helpers, so they are matched.
+void* operator new(size_t size)
+{
+  void* ptr = Allocate(size);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* ptr) noexcept { Deallocate(ptr); }
+void operator delete[](void* ptr) noexcept { Deallocate(ptr); }
+void operator delete(void* ptr, size_t) noexcept { Deallocate(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { Deallocate(ptr); }
+
+static uint8_t s_frames[2][(256 + 3) * 64 * 4];
+static const char* s_transport = "";
+static uint32_t s_failures = 0;
+
+static void CreateFrames()
+{
+  // Every zone changes between both frames and none of them is black, which would be sent as clear screen.
+  for (int i = 0; i < (256 + 3) * 64 * 4; i++)
+  {
+    s_frames[0][i] = (uint8_t)(64 + (i * 7) % 128);
+    s_frames[1][i] = (uint8_t)(64 + (i * 13 + 31) % 128);
+  }
+}
+
+static void ZEDMDCALLBACK OnFrame(uint32_t ticket, ZEDMD_FRAME_STATUS status, const void* userData) {}
+
+static void Expect(const char* name, uint16_t width, uint16_t height)
+{
+  if (s_allocations > 0)
+  {
+    printf("FAIL %s %dx%d %s: %d allocations\n", name, width, height, s_transport, s_allocations);
+    s_failures++;
+  }
+  else
+  {
+    printf("OK   %s %dx%d %s\n", name, width, height, s_transport);
+  }
+  s_allocations = 0;
+}
+
+static void RenderFrames(ZeDMD* pZeDMD, uint16_t width, uint16_t height)
+{
+  pZeDMD->SetFrameSize(width, height);
+
+  s_tracking = true;
+  for (int i = 0; i < 4; i++) pZeDMD->RenderRgb888(s_frames[i & 1]);
+  Expect("RenderRgb888", width, height);
+
+  for (int i = 0; i < 4; i++) pZeDMD->RenderRgb565((uint16_t*)s_frames[i & 1]);
+  Expect("RenderRgb565", width, height);
+
+  for (int i = 0; i < 4; i++)
+  {
+    pZeDMD->RenderFrame(s_frames[i & 1], ZEDMD_FORMAT_BGRA8888, (width + 3) * 4);
+  }
+  Expect("RenderFrame Bgra8888", width, height);
+
+  for (int i = 0; i < 4; i++) pZeDMD->RenderIndexed8(s_frames[i & 1]);
+  Expect("RenderIndexed8", width, height);
+
+  for (int i = 0; i < 4; i++) pZeDMD->RenderFrameAsync(s_frames[i & 1], ZEDMD_FORMAT_RGB888, 0);
+  Expect("RenderFrameAsync", width, height);
+
+  for (int i = 0; i < 4; i++)
+  {
+    pZeDMD->RenderRgb888Region(i * 5, i * 3, width / 3, height / 2, s_frames[i & 1], 0);
+  }
+  Expect("RenderRgb888Region", width, height);
+
+  for (int i = 0; i < 4; i++)
+  {
+    pZeDMD->RenderRgb565Region(i * 5 + 1, i * 3 + 1, width / 4 + 1, height / 3, (uint16_t*)s_frames[i & 1], 0);
+  }
+  Expect("RenderRgb565Region", width, height);
+  s_tracking = false;
+}
+
+int main()
+{
+  CreateFrames();
+
+  ZeDMD* pZeDMD = new ZeDMD();
+  uint8_t palette[256 * 3];
+  memcpy(palette, s_frames[0], sizeof(palette));
+  pZeDMD->SetPalette(palette, 256);
+
+  // Without a ZeDMD listening, the frames are sent into the void and the panel keeps its default geometry.
+  if (!pZeDMD->OpenWiFi("127.0.0.1", 3333) || 128 != pZeDMD->GetWidth() || 32 != pZeDMD->GetHeight())
+  {
+    printf("SKIP the loopback connection isn't available\n");
+    delete pZeDMD;
+    return 77;
+  }
+
+  // The tickets of the async frames are completed by the run thread.
+  pZeDMD->SetFrameCallback(OnFrame, nullptr);
+
+  for (int pass = 0; pass < 2; pass++)
+  {
+    // The frames are copied into the frame queue while the transport keeps up. A frame interval above the latency
+    // budget keeps ZeDMD behind, the changed zones are coalesced into the dirty zones then.
+    s_transport = (0 == pass) ? "idle" : "behind";
+    pZeDMD->SetFramePacing((0 == pass) ? 0 : 1, (0 == pass) ? 0 : 1);
+
+    // Unscaled, centered, upscaled, downscaled and the generic scaling.
+    pZeDMD->DisableUpscaling();
+    RenderFrames(pZeDMD, 128, 32);
+    RenderFrames(pZeDMD, 64, 16);
+    pZeDMD->EnableUpscaling();
+    RenderFrames(pZeDMD, 64, 16);
+    RenderFrames(pZeDMD, 256, 64);
+    RenderFrames(pZeDMD, 192, 64);
+  }
+
+  pZeDMD->Close();
+  delete pZeDMD;
+
+  return (s_failures > 0) ? 1 : 0;
+}
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "FrameUtil.h"
+#include "ZeDMDScale.h"
+
+// Compares the 2x scalers to FrameUtil's ScaleUp() and ScaleDown(), which they replace bit-exact. This test is built
+// with and without ZEDMD_NO_SIMD, so the SSE2 or NEON paths and the scalar paths are covered.
+static uint8_t s_source[256 * 64 * 4];
+static uint8_t s_expected[256 * 64 * 4 * 4];
+static uint8_t s_actual[256 * 64 * 4 * 4];
+static uint32_t s_random = 1;
+static uint32_t s_cases = 0;
+static uint32_t s_failures = 0;
+
+static uint8_t Random()
+{
+  s_random = s_random * 1103515245 + 12345;
+  return (uint8_t)(s_random >> 16);
+}
+
+// Few colors make the scalers take every branch, colors differing in a single byte catch partial comparisons.
+static void CreateFrame(uint16_t width, uint16_t height, uint8_t bytes, uint8_t numColors)
+{
+  // The widest pixel has 4 bytes.
+  uint8_t palette[5][4];
+  bytes = std::min<uint8_t>(bytes, sizeof(palette[0]));
+  numColors = std::min<uint8_t>(numColors, sizeof(palette) / sizeof(palette[0]));
+  for (uint8_t i = 0; i < numColors; i++)
+  {
+    for (uint8_t b = 0; b < bytes; b++) palette[i][b] = (0 == i) ? Random() : palette[0][b];
+    if (i > 0) palette[i][Random() % bytes] ^= i;
+  }
+
+  for (uint32_t i = 0; i < width * height; i++)
+  {
+    memcpy(&s_source[i * bytes], palette[Random() % numColors], bytes);
+  }
+}
+
+static void Compare(const char* name, uint16_t width, uint16_t height, uint8_t bytes, uint8_t numColors, uint32_t size)
+{
+  s_cases++;
+  if (0 != memcmp(s_expected, s_actual, size))
+  {
+    printf("FAIL %s %d bit %dx%d with %d colors\n", name, bytes * 8, width, height, numColors);
+    s_failures++;
+  }
+}
+
+template <typename T>
+static void TestScaleUp(uint16_t width, uint16_t height, uint8_t numColors)
+{
+  const uint8_t bytes = sizeof(T);
+  const uint32_t size = width * height * 4 * bytes;
+  CreateFrame(width, height, bytes, numColors);
+
+  FrameUtil::Helper::ScaleUp(s_expected, s_source, width, height, bytes * 8);
+  memset(s_actual, 0, size);
+  ScaleUp2x((T*)s_actual, (const T*)s_source, width, height);
+
+  Compare("ScaleUp2x", width, height, bytes, numColors, size);
+}
+
+template <typename T>
+static void TestScaleDown(uint16_t width, uint16_t height, uint8_t numColors)
+{
+  const uint8_t bytes = sizeof(T);
+  const uint32_t size = width / 2 * height / 2 * bytes;
+  CreateFrame(width, height, bytes, numColors);
+
+  FrameUtil::Helper::ScaleDown(s_expected, width / 2, height / 2, s_source, width, height, bytes * 8);
+  memset(s_actual, 0, size);
+  ScaleDown2x((T*)s_actual, (const T*)s_source, width, height);
+
+  Compare("ScaleDown2x", width, height, bytes, numColors, size);
+}
+
+// Scaling a rectangle of a region update writes the same pixels as scaling the entire frame.
+template <typename T>
+static void TestRectangles(bool down, uint16_t width, uint16_t height)
+{
+  const uint16_t destWidth = down ? width / 2 : width * 2;
+  const uint16_t destHeight = down ? height / 2 : height * 2;
+  CreateFrame(width, height, sizeof(T), 3);
+
+  if (down)
+    ScaleDown2x((T*)s_expected, (const T*)s_source, width, height);
+  else
+    ScaleUp2x((T*)s_expected, (const T*)s_source, width, height);
+
+  for (uint8_t i = 0; i < 16; i++)
+  {
+    uint16_t left = Random() % destWidth, top = Random() % destHeight;
+    uint16_t right = left + 1 + Random() % (destWidth - left), bottom = top + 1 + Random() % (destHeight - top);
+    memset(s_actual, 0xA5, destWidth * destHeight * sizeof(T));
+
+    if (down)
+      ScaleDown2x((T*)s_actual, (const T*)s_source, width, height, left, top, right, bottom);
+    else
+      ScaleUp2x((T*)s_actual, (const T*)s_source, width, height, left, top, right, bottom);
+
+    s_cases++;
+    for (uint16_t y = top; y < bottom; y++)
+    {
+      const uint32_t offset = (y * destWidth + left) * sizeof(T);
+      if (0 != memcmp(&s_expected[offset], &s_actual[offset], (right - left) * sizeof(T)))
+      {
+        printf("FAIL %s %d bit %dx%d rectangle %d,%d-%d,%d\n", down ? "ScaleDown2x" : "ScaleUp2x",
+               (int)sizeof(T) * 8, width, height, left, top, right, bottom);
+        s_failures++;
+        break;
+      }
+    }
+  }
+}
+
+template <typename T>
+static void TestPixelType()
+{
+  // Odd widths and widths that aren't a multiple of the vector size run through the tails of the SIMD loops.
+  const uint16_t upWidths[] = {2, 3, 7, 8, 9, 15, 16, 17, 31, 33, 64, 65, 127, 128};
+  const uint16_t upHeights[] = {2, 3, 16, 32};
+  const uint16_t downWidths[] = {4, 6, 14, 16, 18, 30, 34, 62, 66, 128, 130, 254, 256};
+  const uint16_t downHeights[] = {4, 6, 32, 64};
+
+  for (uint8_t numColors = 1; numColors <= 5; numColors++)
+  {
+    for (uint16_t height : upHeights)
+    {
+      for (uint16_t width : upWidths) TestScaleUp<T>(width, height, numColors);
+    }
+
+    for (uint16_t height : downHeights)
+    {
+      for (uint16_t width : downWidths)
+      {
+        // FrameUtil's ScaleDown() addresses the source with 16 bit offsets.
+        if (width * height * sizeof(T) < 65536) TestScaleDown<T>(width, height, numColors);
+      }
+    }
+  }
+
+  TestRectangles<T>(false, 128, 32);
+  TestRectangles<T>(false, 33, 17);
+  TestRectangles<T>(true, 256, 64);
+  TestRectangles<T>(true, 130, 34);
+}
+
+int main()
+{
+#if defined(ZEDMD_SSE2)
+  const char* path = "SSE2";
+#elif defined(ZEDMD_NEON)
+  const char* path = "NEON";
+#else
+  const char* path = "scalar";
+#endif
+
+  TestPixelType<uint8_t>();
+  TestPixelType<uint16_t>();
+  TestPixelType<Rgb888Pixel>();
+  TestPixelType<uint32_t>();
+
+  printf("%s %s: %d of %d cases passed\n", (s_failures > 0) ? "FAIL" : "OK  ", path, s_cases - s_failures, s_cases);
+
+  return (s_failures > 0) ? 1 : 0;
+}